@@ -0,0 +1,199 @@
+#ifndef _BINARY_LOG_H_
+#define _BINARY_LOG_H_
+
+// C++ Header File(s)
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+#include <type_traits>
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// Deferred/binary logging keeps the producer away from text formatting. A log call only copies
+    /// the call site key, a timestamp and its raw arguments into a record:
+    ///
+    ///     entry  := u64 site key, u64 realtime ns, { u8 arg type, payload }*
+    ///
+    /// In a binary log file every record is framed as "u32 length, u8 kind, payload" after the
+    /// BINARY_LOG_MAGIC header. Each call site is described once per file by a BINARY_SITE record
+    /// (key, level, line, prefix, file), which is what lets LogDecoder rebuild the text lines offline.
+    ///
+    #define BINARY_LOG_MAGIC        "GLOGBIN1"
+    #define BINARY_LOG_MAGIC_SIZE   8
+
+    typedef enum BINARY_RECORD_KIND
+    {
+      BINARY_SITE  = 1,
+      BINARY_ENTRY = 2,
+    } BinaryRecordKind;
+
+    typedef enum BINARY_ARG_TYPE
+    {
+      ARG_SIGNED   = 1,     // i64
+      ARG_UNSIGNED = 2,     // u64
+      ARG_DOUBLE   = 3,     // f64
+      ARG_BOOL     = 4,     // u8
+      ARG_CHAR     = 5,     // u8
+      ARG_POINTER  = 6,     // u64
+      ARG_STRING   = 7,     // u32 length + bytes, rendered as " value,"
+      ARG_TEXT     = 8,     // u32 length + bytes, appended as-is (plain text log calls)
+    } BinaryArgType;
+
+    class BinaryEncoder
+    {
+      public:
+         static uint64_t now()
+         {
+             struct timespec ts;
+             clock_gettime(CLOCK_REALTIME, &ts);
+             return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+         }
+
+         static void beginEntry(LogFormatter& out, const void* site, uint64_t timestamp)
+         {
+             putInt(out, (uint64_t)(uintptr_t)site);
+             putInt(out, timestamp);
+         }
+
+         template <typename T>
+         static void putInt(LogFormatter& out, T value)
+         {
+             out.append((const char*)&value, sizeof(value));
+         }
+
+         static void putString(LogFormatter& out, BinaryArgType type, std::string_view text)
+         {
+             out.append((char)type);
+             putInt(out, (uint32_t)text.size());
+             out.append(text);
+         }
+
+         ///
+         /// Trivially copyable arguments are stored raw, strings are copied inline and anything else
+         /// is rendered through LogFormatter right away and stored as a string.
+         ///
+         template <typename T>
+         static void encodeArg(LogFormatter& out, const T& value)
+         {
+             typedef typename std::decay<T>::type Type;
+
+             if constexpr (LogFormatDetail::IsLazy<Type>::value)
+             {
+                 // Called here, on the logging thread, the result is stored
+                 encodeArg(out, value());
+             }
+             else if constexpr (std::is_same<Type, bool>::value)
+             {
+                 out.append((char)ARG_BOOL);
+                 out.append(value ? '\1' : '\0');
+             }
+             else if constexpr (std::is_same<Type, char>::value ||
+                                std::is_same<Type, signed char>::value ||
+                                std::is_same<Type, unsigned char>::value)
+             {
+                 out.append((char)ARG_CHAR);
+                 out.append((char)value);
+             }
+             else if constexpr (std::is_integral<Type>::value && std::is_signed<Type>::value)
+             {
+                 out.append((char)ARG_SIGNED);
+                 putInt(out, (int64_t)value);
+             }
+             else if constexpr (std::is_integral<Type>::value)
+             {
+                 out.append((char)ARG_UNSIGNED);
+                 putInt(out, (uint64_t)value);
+             }
+             else if constexpr (std::is_floating_point<Type>::value)
+             {
+                 out.append((char)ARG_DOUBLE);
+                 putInt(out, (double)value);
+             }
+             else if constexpr (std::is_pointer<Type>::value &&
+                                !std::is_same<typename std::remove_cv<typename std::remove_pointer<Type>::type>::type, char>::value)
+             {
+                 out.append((char)ARG_POINTER);
+                 putInt(out, (uint64_t)(uintptr_t)value);
+             }
+             else
+             {
+                 // Strings are copied as-is, the rest is rendered here
+                 LogFormatter text;
+                 text.write(value);
+                 putString(out, ARG_STRING, text.view());
+             }
+         }
+    };
+
+    class BinaryDecoder
+    {
+      public:
+         template <typename T>
+         static bool getInt(const char*& pos, const char* end, T& value)
+         {
+             if ((size_t)(end - pos) < sizeof(value))
+                 return false;
+             memcpy(&value, pos, sizeof(value));
+             pos += sizeof(value);
+             return true;
+         }
+
+         static bool getString(const char*& pos, const char* end, std::string_view& text)
+         {
+             uint32_t length;
+             if (!getInt(pos, end, length) || (size_t)(end - pos) < length)
+                 return false;
+             text = std::string_view(pos, length);
+             pos += length;
+             return true;
+         }
+
+         ///
+         /// Renders the arguments of an entry exactly the way the text mode formatter would
+         ///
+         static bool renderArgs(const char* pos, const char* end, LogFormatter& fmt)
+         {
+             while (pos < end)
+             {
+                 const char type = *pos++;
+                 switch (type)
+                 {
+                     case ARG_SIGNED:   { int64_t  v; if (!getInt(pos, end, v)) return false; fmt % v; break; }
+                     case ARG_UNSIGNED: { uint64_t v; if (!getInt(pos, end, v)) return false; fmt % v; break; }
+                     case ARG_DOUBLE:   { double   v; if (!getInt(pos, end, v)) return false; fmt % v; break; }
+                     case ARG_BOOL:     { uint8_t  v; if (!getInt(pos, end, v)) return false; fmt % (v != 0); break; }
+                     case ARG_CHAR:     { char     v; if (!getInt(pos, end, v)) return false; fmt % v; break; }
+                     case ARG_POINTER:
+                     {
+                         uint64_t v;
+                         if (!getInt(pos, end, v)) return false;
+                         fmt % (const void*)(uintptr_t)v;
+                         break;
+                     }
+                     case ARG_STRING:
+                     case ARG_TEXT:
+                     {
+                         std::string_view text;
+                         if (!getString(pos, end, text)) return false;
+                         if (type == ARG_TEXT)
+                             fmt.append(text);
+                         else
+                             fmt % text;
+                         break;
+                     }
+                     default:
+                         return false;
+                 }
+             }
+             return true;
+         }
+    };
+
+} // End of namespace
+
+#endif // End of _BINARY_LOG_H_
@@ -0,0 +1,179 @@
+#ifndef _CONSOLE_OUTPUT_H_
+#define _CONSOLE_OUTPUT_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <unistd.h>
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+
+namespace CPlusPlusLogging
+{
+    // enum for the level colouring of console records, see Logger::setConsoleColor()
+    typedef enum CONSOLE_COLOR
+    {
+      COLOR_NEVER       = 1,        // Plain text (default).
+      COLOR_AUTO        = 2,        // Colours when standard output is a terminal, NO_COLOR is unset and TERM is not "dumb".
+      COLOR_ALWAYS      = 3,        // Colours also into pipes and files, e.g. for "less -R".
+    } ConsoleColor;
+
+    // Console output the writer thread collects before one write() when standard output is
+    // not a terminal
+    #define CONSOLE_BUFFER_SIZE         (64 * 1024)
+
+    ///
+    /// Standard output of the logger. Every line is assembled in full, colour escapes included,
+    /// and handed to one write(STDOUT_FILENO): the kernel keeps lines up to PIPE_BUF bytes
+    /// whole, so concurrent synchronous loggers need no lock and never interleave.
+    ///
+    /// The writer thread of the asynchronous mode buffers instead: line by line on a terminal,
+    /// in blocks of CONSOLE_BUFFER_SIZE (and at the end of every drain pass) on a pipe or file.
+    /// The terminal check is made on construction and again by detect().
+    ///
+    class ConsoleOutput
+    {
+      public:
+         ConsoleOutput()
+         {
+             m_Mode.store(COLOR_NEVER);
+             m_Colored.store(false);
+             m_Terminal.store(false);
+             detect();
+         }
+
+         /// Checks again what standard output is, e.g. after it was redirected
+         void detect()
+         {
+             m_Terminal.store(isatty(STDOUT_FILENO) == 1, std::memory_order_relaxed);
+             setColor(m_Mode.load(std::memory_order_relaxed));
+         }
+
+         void setColor(ConsoleColor mode)
+         {
+             bool colored = (mode == COLOR_ALWAYS);
+             if (mode == COLOR_AUTO)
+             {
+                 const char* term = getenv("TERM");
+                 colored = m_Terminal.load(std::memory_order_relaxed) && getenv("NO_COLOR") == NULL &&
+                           !(term != NULL && strcmp(term, "dumb") == 0);
+             }
+             m_Mode.store(mode, std::memory_order_relaxed);
+             m_Colored.store(colored, std::memory_order_relaxed);
+         }
+
+         bool terminal() const { return m_Terminal.load(std::memory_order_relaxed); }
+
+         /// Escape sequence a line of the level starts with, empty without colours
+         std::string_view prefix(int level) const
+         {
+             if (!m_Colored.load(std::memory_order_relaxed))
+                 return std::string_view();
+
+             // Indexed like the LOG_LEVEL values, ALWAYS_LOG_THIS and custom levels stay plain
+             static const std::string_view prefixes[] =
+             {
+                 std::string_view(),                        // DISABLE_LOG
+                 std::string_view("\033[1;31m", 7),         // FATAL:   bold red
+                 std::string_view("\033[31m", 5),           // ERROR:   red
+                 std::string_view("\033[33m", 5),           // WARNING: yellow
+                 std::string_view("\033[32m", 5),           // INFO:    green
+                 std::string_view("\033[36m", 5),           // DEBUG:   cyan
+                 std::string_view("\033[90m", 5),           // TRACE:   grey
+                 std::string_view("\033[35m", 5),           // BUFFER:  magenta
+             };
+             return (level >= 0 && level < 8) ? prefixes[level] : std::string_view();
+         }
+
+         /// Resets the colour at the end of a line that has a prefix
+         static std::string_view suffix(std::string_view prefix)
+         {
+             return prefix.empty() ? std::string_view() : std::string_view("\033[0m", 4);
+         }
+
+         ///
+         /// "<prefix><timestamp>  <text><suffix>\n" into any buffer with append(const char*, size_t)
+         ///
+         template <typename Buffer>
+         void appendLine(Buffer& out, int level, std::string_view timestamp, std::string_view text) const
+         {
+             const std::string_view start = prefix(level);
+             out.append(start.data(), start.size());
+             out.append(timestamp.data(), timestamp.size());
+             if (!timestamp.empty())
+                 out.append("  ", 2);
+             out.append(text.data(), text.size());
+             const std::string_view end = suffix(start);
+             out.append(end.data(), end.size());
+             out.append("\n", 1);
+         }
+
+         /// Synchronous loggers, from any thread. Returns the bytes written.
+         size_t writeLine(int level, std::string_view timestamp, std::string_view text) const
+         {
+             LogFormatter line;
+             appendLine(line, level, timestamp, text);
+             writeOut(line.view());
+             return line.size();
+         }
+
+         ///
+         /// The writer thread only. Returns true if the line went out right away (terminal, or
+         /// the block was full).
+         ///
+         bool buffer(int level, std::string_view text)
+         {
+             appendLine(m_Buffer, level, std::string_view(), text);
+             if (!terminal() && m_Buffer.size() < CONSOLE_BUFFER_SIZE)
+                 return false;
+             flush();
+             return true;
+         }
+
+         /// The writer thread only
+         void flush()
+         {
+             if (m_Buffer.empty())
+                 return;
+             writeOut(m_Buffer);
+             m_Buffer.clear();
+         }
+
+         /// Buffered and not yet written, for the crash handler once the writer is parked
+         std::string_view pending() const { return m_Buffer; }
+
+      private:
+         static void writeOut(std::string_view data)
+         {
+             size_t done = 0;
+             while (done < data.size())
+             {
+                 const ssize_t n = ::write(STDOUT_FILENO, data.data() + done, data.size() - done);
+                 if (n < 0 && errno == EINTR)
+                     continue;
+                 if (n <= 0)
+                     break;          // Nowhere to report a failing console
+                 done += (size_t)n;
+             }
+         }
+
+         ConsoleOutput(const ConsoleOutput& obj);
+         void operator=(const ConsoleOutput& obj);
+
+      private:
+         std::atomic<ConsoleColor>   m_Mode;
+         std::atomic<bool>           m_Colored;
+         std::atomic<bool>           m_Terminal;
+         std::string                 m_Buffer;       // writer thread only
+    };
+
+} // End of namespace
+
+#endif // End of _CONSOLE_OUTPUT_H_
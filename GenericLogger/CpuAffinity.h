@@ -0,0 +1,138 @@
+#ifndef _CPU_AFFINITY_H_
+#define _CPU_AFFINITY_H_
+
+// C++ Header File(s)
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// CPU and NUMA node helpers for pinning the logger's background threads. The node layout
+    /// comes from sysfs (/sys/devices/system/node), so there is no libnuma dependency; on a
+    /// kernel without NUMA support every CPU is on node 0.
+    ///
+    class CpuAffinity
+    {
+      public:
+         ///
+         /// Parses a kernel CPU list ("0-3,8,10-11"). Returns false, leaving 'cpus' empty, on
+         /// anything else.
+         ///
+         static bool parseList(std::string_view list, std::vector<int>& cpus)
+         {
+             cpus.clear();
+             while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+                 list.remove_suffix(1);
+
+             size_t pos = 0;
+             while (pos < list.size())
+             {
+                 int first, last;
+                 if (!number(list, pos, first))
+                     break;
+                 last = first;
+                 if (pos < list.size() && list[pos] == '-')
+                 {
+                     ++pos;
+                     if (!number(list, pos, last) || last < first)
+                         break;
+                 }
+                 for (int cpu = first; cpu <= last; ++cpu)
+                     cpus.push_back(cpu);
+
+                 if (pos == list.size())
+                     return true;
+                 if (list[pos] != ',')
+                     break;
+                 ++pos;
+             }
+             cpus.clear();
+             return false;
+         }
+
+         /// The CPUs of a NUMA node, empty if the node does not exist
+         static std::vector<int> nodeCpus(int node)
+         {
+             std::vector<int> cpus;
+             char path[64];
+             snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+             FILE* file = fopen(path, "r");
+             if (file == NULL)
+             {
+                 if (node == 0)
+                     onlineCpus(cpus);
+                 return cpus;
+             }
+
+             char   list[4096];
+             size_t length = fread(list, 1, sizeof(list) - 1, file);
+             fclose(file);
+             parseList(std::string_view(list, length), cpus);
+             return cpus;
+         }
+
+         /// The node the calling thread runs on right now, 0 if unknown
+         static int currentNode()
+         {
+             unsigned cpu = 0, node = 0;
+             if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+                 return 0;
+             return (int)node;
+         }
+
+         ///
+         /// Pins 'thread' to 'cpus'. An empty list lifts the pinning again (every online CPU).
+         ///
+         static bool pin(pthread_t thread, const std::vector<int>& cpus)
+         {
+             std::vector<int> all;
+             const std::vector<int>* list = &cpus;
+             if (cpus.empty())
+             {
+                 onlineCpus(all);
+                 list = &all;
+             }
+
+             cpu_set_t set;
+             CPU_ZERO(&set);
+             for (size_t i = 0; i < list->size(); ++i)
+             {
+                 if ((*list)[i] < 0 || (*list)[i] >= CPU_SETSIZE)
+                     return false;
+                 CPU_SET((*list)[i], &set);
+             }
+             return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+         }
+
+      private:
+         static bool number(std::string_view list, size_t& pos, int& value)
+         {
+             const size_t start = pos;
+             value = 0;
+             while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9' && value < CPU_SETSIZE)
+                 value = value * 10 + (list[pos++] - '0');
+             return pos != start;
+         }
+
+         static void onlineCpus(std::vector<int>& cpus)
+         {
+             const long count = sysconf(_SC_NPROCESSORS_CONF);
+             for (long cpu = 0; cpu < count && cpu < CPU_SETSIZE; ++cpu)
+                 cpus.push_back((int)cpu);
+         }
+    };
+
+} // End of namespace
+
+#endif // End of _CPU_AFFINITY_H_
@@ -0,0 +1,619 @@
+#ifndef _FILE_WRITER_H_
+#define _FILE_WRITER_H_
+
+// C++ Header File(s)
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define LOG_HAVE_IO_URING   1
+#endif
+#endif
+
+namespace CPlusPlusLogging
+{
+    // enum for how the batched mode writes the log file, see Logger::setFileBackend()
+    typedef enum FILE_BACKEND
+    {
+      FILE_BACKEND_WRITEV = 1,      // One blocking writev() per run of batches (default).
+      FILE_BACKEND_PWRITE = 2,      // Batches are copied into large buffers, one blocking pwrite() per buffer.
+      FILE_BACKEND_URING  = 3,      // The same buffers, registered with io_uring and written asynchronously,
+                                    // several at a time. Falls back to FILE_BACKEND_PWRITE without io_uring.
+    } FileBackend;
+
+    // Buffers of a FileWriter and the writes it keeps in flight at most
+    #define FILE_WRITER_BUFFERS         8
+    #define FILE_WRITER_BUFFER_SIZE     (256 * 1024)
+
+    // Block size O_DIRECT writes are aligned and padded to
+    #define FILE_WRITER_ALIGNMENT       4096
+
+    ///
+    /// Log file writer of the batched mode for FILE_BACKEND_PWRITE and FILE_BACKEND_URING. Lines
+    /// are copied into FILE_WRITER_BUFFERS aligned buffers; a full buffer is written at once, a
+    /// partly filled one at the end of every writer pass (submit()) and on flush(). The file
+    /// offsets are kept here, so no O_APPEND is needed.
+    ///
+    /// With io_uring the buffers are registered once (IORING_REGISTER_BUFFERS) and written with
+    /// IORING_OP_WRITE_FIXED. The writer thread only waits when every buffer is still in
+    /// flight, or on flush(), which with 'sync' links an fdatasync behind the writes
+    /// (IOSQE_IO_LINK, IOSQE_IO_DRAIN). The ring is driven through the raw system calls, there
+    /// is no liburing dependency. If io_uring cannot be set up, the same buffers go out with
+    /// pwrite().
+    ///
+    /// With 'direct' the file is opened with O_DIRECT, since the buffers are aligned anyway. A
+    /// flush() pads the last block with zeros and writes it again once more lines arrive;
+    /// close() cuts the padding off, and after a crash open() skips it, like MappedFile does.
+    /// Writer thread only.
+    ///
+    class FileWriter
+    {
+      public:
+         FileWriter() : m_Fd(-1), m_Direct(false), m_Memory(NULL), m_Current(0), m_Fill(0),
+                        m_Carried(0), m_Offset(0), m_InFlight(0), m_Fixed(false)
+         {
+             memset(&m_Ring, 0, sizeof(m_Ring));
+             m_Ring.fd = -1;
+         }
+
+         ~FileWriter() { close(); }
+
+         bool isOpen() const { return m_Fd >= 0; }
+         bool usesRing() const { return m_Ring.fd >= 0; }
+         bool direct() const { return m_Direct; }
+         int fd() const { return m_Fd; }
+
+         bool open(const std::string& path, FileBackend backend, bool direct)
+         {
+             close();
+
+             void* memory = NULL;
+             if (posix_memalign(&memory, FILE_WRITER_ALIGNMENT, FILE_WRITER_BUFFERS * FILE_WRITER_BUFFER_SIZE) != 0)
+                 return false;
+             m_Memory = (char*)memory;
+             for (size_t i = 0; i < FILE_WRITER_BUFFERS; ++i)
+             {
+                 m_Buffers[i].busy         = false;
+                 m_Buffers[i].iov.iov_base = m_Memory + i * FILE_WRITER_BUFFER_SIZE;
+                 m_Buffers[i].iov.iov_len  = FILE_WRITER_BUFFER_SIZE;
+             }
+
+             if (!openFile(path, direct))
+             {
+                 free(m_Memory);
+                 m_Memory = NULL;
+                 return false;
+             }
+
+             if (backend == FILE_BACKEND_URING && !setupRing())
+                 printf("FileWriter::open() -- io_uring not available, writing %s with pwrite()!!\n", path.c_str());
+             return true;
+         }
+
+         ///
+         /// Copies 'data' into the buffers, every buffer that fills up is written right away
+         ///
+         void append(const char* data, size_t length)
+         {
+             while (length > 0)
+             {
+                 const size_t room  = FILE_WRITER_BUFFER_SIZE - m_Fill;
+                 const size_t chunk = (length < room) ? length : room;
+                 memcpy(buffer() + m_Fill, data, chunk);
+                 m_Fill += chunk;
+                 data   += chunk;
+                 length -= chunk;
+
+                 if (m_Fill == FILE_WRITER_BUFFER_SIZE)
+                 {
+                     write(FILE_WRITER_BUFFER_SIZE, false);
+                     m_Offset += FILE_WRITER_BUFFER_SIZE;
+                     next();
+                 }
+             }
+         }
+
+         ///
+         /// End of a writer pass: the partly filled buffer goes out without waiting for it.
+         /// O_DIRECT keeps its last block back for flush().
+         ///
+         void submit()
+         {
+             if (m_Fd < 0 || m_Direct || m_Fill == 0)
+                 return;
+             write(m_Fill, false);
+             m_Offset += m_Fill;
+             next();
+         }
+
+         ///
+         /// Writes out everything and waits for it. With 'sync' the data is also on the disk
+         /// when this returns.
+         ///
+         void flush(bool sync)
+         {
+             if (m_Fd < 0)
+                 return;
+
+             if (m_Fill > m_Carried)
+             {
+                 size_t length = m_Fill;
+                 if (m_Direct)
+                 {
+                     length = (m_Fill + FILE_WRITER_ALIGNMENT - 1) / FILE_WRITER_ALIGNMENT * FILE_WRITER_ALIGNMENT;
+                     memset(buffer() + m_Fill, 0, length - m_Fill);
+                 }
+                 write(length, sync);
+
+                 // The partial last block starts the next buffer and is written again later.
+                 // The writes are waited for below, before anything can overlap it.
+                 const size_t tail = m_Direct ? m_Fill % FILE_WRITER_ALIGNMENT : 0;
+                 const char*  last = buffer() + m_Fill - tail;
+                 m_Offset += m_Fill - tail;
+                 next();
+                 memcpy(buffer(), last, tail);
+                 m_Fill    = tail;
+                 m_Carried = tail;
+             }
+             else if (sync && usesRing())
+             {
+                 queueSync();
+                 ++m_InFlight;
+                 enter(1, 0, 0);
+             }
+
+             while (m_InFlight > 0)
+                 reap(true);
+             if (sync && !usesRing() && fdatasync(m_Fd) != 0)
+                 printf("FileWriter::flush() -- fdatasync failed (%s)!!\n", strerror(errno));
+         }
+
+         ///
+         /// Rotation: finishes the current file and carries on with a new one at 'path'
+         ///
+         bool reopen(const std::string& path)
+         {
+             const bool direct = m_Direct;
+             flush(false);
+             closeFile();
+             return openFile(path, direct);
+         }
+
+         void close()
+         {
+             if (m_Fd >= 0)
+             {
+                 flush(false);
+                 closeFile();
+             }
+             teardownRing();
+             free(m_Memory);
+             m_Memory = NULL;
+         }
+
+         /// Copied in and not yet written, for the crash handler once the writer is parked
+         std::string_view pending() const
+         {
+             if (m_Memory == NULL)
+                 return std::string_view();
+             return std::string_view(m_Memory + m_Current * FILE_WRITER_BUFFER_SIZE + m_Carried, m_Fill - m_Carried);
+         }
+
+      private:
+         struct Buffer
+         {
+             bool            busy;          // in flight
+             uint64_t        offset;
+             size_t          length;
+             struct iovec    iov;           // registered extent, also the IORING_OP_WRITEV fallback
+         };
+
+         /// The mapped rings of an io_uring instance
+         struct Ring
+         {
+             int             fd;
+             unsigned*       sqHead;
+             unsigned*       sqTail;
+             unsigned*       sqMask;
+             unsigned*       sqArray;
+             unsigned*       cqHead;
+             unsigned*       cqTail;
+             unsigned*       cqMask;
+             void*           sqes;
+             void*           cqes;
+             void*           sqMap;
+             size_t          sqMapSize;
+             void*           cqMap;
+             size_t          cqMapSize;
+             size_t          sqesSize;
+         };
+
+         static const uint64_t SYNC_TAG = ~(uint64_t)0;
+
+         char* buffer() { return m_Memory + m_Current * FILE_WRITER_BUFFER_SIZE; }
+
+         /// Moves to the next buffer, waiting until it is back from the kernel
+         void next()
+         {
+             m_Current = (m_Current + 1) % FILE_WRITER_BUFFERS;
+             while (m_Buffers[m_Current].busy)
+                 reap(true);
+             m_Fill    = 0;
+             m_Carried = 0;
+         }
+
+         /// Writes 'length' bytes of the current buffer at m_Offset, an fdatasync behind them on 'sync'
+         void write(size_t length, bool sync)
+         {
+             Buffer& current = m_Buffers[m_Current];
+             current.offset = m_Offset;
+             current.length = length;
+
+             if (!usesRing())
+             {
+                 writeAt(buffer(), length, m_Offset);
+                 return;
+             }
+
+#ifdef LOG_HAVE_IO_URING
+             struct io_uring_sqe* sqe = nextSqe();
+             if (m_Fixed)
+             {
+                 sqe->opcode    = IORING_OP_WRITE_FIXED;
+                 sqe->addr      = (uint64_t)(uintptr_t)buffer();
+                 sqe->len       = (uint32_t)length;
+                 sqe->buf_index = (uint16_t)m_Current;
+             }
+             else
+             {
+                 current.iov.iov_len = length;
+                 sqe->opcode = IORING_OP_WRITEV;
+                 sqe->addr   = (uint64_t)(uintptr_t)&current.iov;
+                 sqe->len    = 1;
+             }
+             sqe->fd        = m_Fd;
+             sqe->off       = m_Offset;
+             sqe->user_data = m_Current;
+             if (sync)
+                 sqe->flags |= IOSQE_IO_LINK;
+             commitSqe();
+
+             current.busy = true;
+             ++m_InFlight;
+             if (sync)
+             {
+                 queueSync();
+                 ++m_InFlight;
+             }
+             enter(sync ? 2 : 1, 0, 0);
+#endif
+         }
+
+         /// fdatasync once everything before it is done
+         void queueSync()
+         {
+#ifdef LOG_HAVE_IO_URING
+             struct io_uring_sqe* sqe = nextSqe();
+             sqe->opcode      = IORING_OP_FSYNC;
+             sqe->fd          = m_Fd;
+             sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+             sqe->flags      |= IOSQE_IO_DRAIN;
+             sqe->user_data   = SYNC_TAG;
+             commitSqe();
+#endif
+         }
+
+         /// Handles the completions there are, with 'wait' at least one
+         void reap(bool wait)
+         {
+#ifdef LOG_HAVE_IO_URING
+             unsigned head = *m_Ring.cqHead;
+             if (wait && head == __atomic_load_n(m_Ring.cqTail, __ATOMIC_ACQUIRE) && !enter(0, 1, IORING_ENTER_GETEVENTS))
+                 return;
+
+             const unsigned tail = __atomic_load_n(m_Ring.cqTail, __ATOMIC_ACQUIRE);
+             const struct io_uring_cqe* cqes = (const struct io_uring_cqe*)m_Ring.cqes;
+             while (head != tail)
+             {
+                 const struct io_uring_cqe& cqe = cqes[head & *m_Ring.cqMask];
+                 complete(cqe.user_data, cqe.res);
+                 ++head;
+             }
+             __atomic_store_n(m_Ring.cqHead, head, __ATOMIC_RELEASE);
+#else
+             (void)wait;
+#endif
+         }
+
+         void complete(uint64_t tag, int result)
+         {
+             --m_InFlight;
+             if (tag == SYNC_TAG)
+             {
+                 if (result < 0)
+                     printf("FileWriter::complete() -- fdatasync failed (%s)!!\n", strerror(-result));
+                 return;
+             }
+
+             Buffer& done = m_Buffers[tag];
+             done.busy = false;
+             if (result < 0)
+             {
+                 printf("FileWriter::complete() -- Write failed (%s), records lost!!\n", strerror(-result));
+             }
+             else if ((size_t)result < done.length)
+             {
+                 // Short write, the rest goes out the plain way. O_DIRECT needs an aligned offset,
+                 // so that starts again at the block the kernel stopped in.
+                 const size_t from = resumeAt((size_t)result);
+                 writeAt((const char*)done.iov.iov_base + from, done.length - from, done.offset + from);
+             }
+         }
+
+         /// Where a write that got 'written' bytes out carries on: O_DIRECT goes back to the start of the block
+         size_t resumeAt(size_t written) const
+         {
+             return m_Direct ? written / FILE_WRITER_ALIGNMENT * FILE_WRITER_ALIGNMENT : written;
+         }
+
+         void writeAt(const char* data, size_t length, uint64_t offset)
+         {
+             while (length > 0)
+             {
+                 const ssize_t n = pwrite(m_Fd, data, length, (off_t)offset);
+                 if (n < 0 && errno == EINTR)
+                     continue;
+
+                 // Short O_DIRECT writes carry on at the block they stopped in
+                 const size_t done = (n > 0) ? resumeAt((size_t)n) : 0;
+                 if (done == 0)
+                 {
+                     printf("FileWriter::writeAt() -- Write failed (%s), records lost!!\n", n < 0 ? strerror(errno) : "short write");
+                     return;
+                 }
+                 data   += done;
+                 length -= done;
+                 offset += done;
+             }
+         }
+
+         ///
+         /// Opens the file and finds where new lines go. With O_DIRECT the last partial block
+         /// is read back into the first buffer, it is rewritten together with the next lines.
+         ///
+         bool openFile(const std::string& path, bool direct)
+         {
+             const int fd = ::open(path.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+             if (fd < 0)
+             {
+                 printf("FileWriter::openFile() -- Unable to open %s!!\n", path.c_str());
+                 return false;
+             }
+
+             struct stat st;
+             if (fstat(fd, &st) != 0)
+             {
+                 ::close(fd);
+                 return false;
+             }
+
+             m_Current = 0;
+             m_Fill    = 0;
+             m_Carried = 0;
+             m_Offset  = (uint64_t)st.st_size;
+             m_Direct  = false;
+             m_Fd      = fd;
+             if (!direct)
+                 return true;
+
+             const int directFd = ::open(path.c_str(), O_WRONLY|O_DIRECT|O_CLOEXEC);
+             if (directFd < 0)
+             {
+                 printf("FileWriter::openFile() -- No O_DIRECT for %s, using the page cache!!\n", path.c_str());
+                 return true;
+             }
+
+             const uint64_t end     = findEnd(fd, (uint64_t)st.st_size);
+             const uint64_t aligned = end / FILE_WRITER_ALIGNMENT * FILE_WRITER_ALIGNMENT;
+             const size_t   tail    = (size_t)(end - aligned);
+             if (tail > 0 && pread(fd, buffer(), tail, (off_t)aligned) != (ssize_t)tail)
+             {
+                 ::close(directFd);
+                 return true;
+             }
+
+             ::close(fd);
+             m_Fd      = directFd;
+             m_Direct  = true;
+             m_Offset  = aligned;
+             m_Fill    = tail;
+             m_Carried = tail;
+             return true;
+         }
+
+         void closeFile()
+         {
+             // The written extent ends with the zero padding of the last block
+             if (m_Direct && ftruncate(m_Fd, (off_t)(m_Offset + m_Fill)) != 0)
+             {
+                 // The padding stays, the next open() skips it
+             }
+             ::close(m_Fd);
+             m_Fd = -1;
+         }
+
+         /// Same as MappedFile: the end of the content before a zero filled tail
+         static uint64_t findEnd(int fd, uint64_t size)
+         {
+             char chunk[4096];
+             while (size > 0)
+             {
+                 const size_t  length = (size < sizeof(chunk)) ? (size_t)size : sizeof(chunk);
+                 const ssize_t got    = pread(fd, chunk, length, (off_t)(size - length));
+                 if (got != (ssize_t)length)
+                     return size;
+
+                 for (size_t i = length; i > 0; --i)
+                 {
+                     if (chunk[i - 1] != '\0')
+                         return size - length + i;
+                 }
+                 size -= length;
+             }
+             return 0;
+         }
+
+#ifdef LOG_HAVE_IO_URING
+         bool setupRing()
+         {
+             struct io_uring_params params;
+             memset(&params, 0, sizeof(params));
+             const int fd = (int)syscall(__NR_io_uring_setup, 2 * FILE_WRITER_BUFFERS, &params);
+             if (fd < 0)
+                 return false;
+
+             Ring& ring = m_Ring;
+             ring.fd        = fd;
+             ring.sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+             ring.cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+             ring.sqesSize  = params.sq_entries * sizeof(struct io_uring_sqe);
+             const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+             if (single)
+                 ring.sqMapSize = ring.cqMapSize = (ring.sqMapSize > ring.cqMapSize) ? ring.sqMapSize : ring.cqMapSize;
+
+             ring.sqMap = mmap(NULL, ring.sqMapSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+             ring.cqMap = (ring.sqMap == MAP_FAILED || single) ? ring.sqMap :
+                          mmap(NULL, ring.cqMapSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+             ring.sqes  = mmap(NULL, ring.sqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+             if (ring.sqMap == MAP_FAILED || ring.cqMap == MAP_FAILED || ring.sqes == MAP_FAILED)
+             {
+                 teardownRing();
+                 return false;
+             }
+
+             char* sq = (char*)ring.sqMap;
+             char* cq = (char*)ring.cqMap;
+             ring.sqHead  = (unsigned*)(sq + params.sq_off.head);
+             ring.sqTail  = (unsigned*)(sq + params.sq_off.tail);
+             ring.sqMask  = (unsigned*)(sq + params.sq_off.ring_mask);
+             ring.sqArray = (unsigned*)(sq + params.sq_off.array);
+             ring.cqHead  = (unsigned*)(cq + params.cq_off.head);
+             ring.cqTail  = (unsigned*)(cq + params.cq_off.tail);
+             ring.cqMask  = (unsigned*)(cq + params.cq_off.ring_mask);
+             ring.cqes    = cq + params.cq_off.cqes;
+
+             // Pinned once, so the kernel does not map the pages again for every write.
+             // RLIMIT_MEMLOCK may refuse, the buffers are then written with IORING_OP_WRITEV.
+             struct iovec iov[FILE_WRITER_BUFFERS];
+             for (size_t i = 0; i < FILE_WRITER_BUFFERS; ++i)
+                 iov[i] = m_Buffers[i].iov;
+             m_Fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, FILE_WRITER_BUFFERS) == 0;
+             return true;
+         }
+
+         void teardownRing()
+         {
+             Ring& ring = m_Ring;
+             if (ring.fd < 0)
+                 return;
+             if (ring.sqes != NULL && ring.sqes != MAP_FAILED)
+                 munmap(ring.sqes, ring.sqesSize);
+             if (ring.cqMap != NULL && ring.cqMap != MAP_FAILED && ring.cqMap != ring.sqMap)
+                 munmap(ring.cqMap, ring.cqMapSize);
+             if (ring.sqMap != NULL && ring.sqMap != MAP_FAILED)
+                 munmap(ring.sqMap, ring.sqMapSize);
+             ::close(ring.fd);
+             memset(&ring, 0, sizeof(ring));
+             ring.fd = -1;
+             m_Fixed = false;
+         }
+
+         /// At most FILE_WRITER_BUFFERS writes and one fsync are queued, the ring has room for twice that
+         struct io_uring_sqe* nextSqe()
+         {
+             const unsigned tail = *m_Ring.sqTail;
+             struct io_uring_sqe* sqe = (struct io_uring_sqe*)m_Ring.sqes + (tail & *m_Ring.sqMask);
+             memset(sqe, 0, sizeof(*sqe));
+             return sqe;
+         }
+
+         void commitSqe()
+         {
+             const unsigned tail = *m_Ring.sqTail;
+             m_Ring.sqArray[tail & *m_Ring.sqMask] = tail & *m_Ring.sqMask;
+             __atomic_store_n(m_Ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+         }
+
+         /// False once the ring failed and was given up, see abandonRing()
+         bool enter(unsigned submit, unsigned wait, unsigned flags)
+         {
+             while (syscall(__NR_io_uring_enter, m_Ring.fd, submit, wait, flags, NULL, 0) < 0)
+             {
+                 if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                 {
+                     printf("FileWriter::enter() -- io_uring_enter failed (%s), writing with pwrite()!!\n", strerror(errno));
+                     abandonRing();
+                     return false;
+                 }
+             }
+             return true;
+         }
+
+         ///
+         /// Falls back to pwrite() for good. Writes that never completed are nothing to wait for
+         /// any more (flush() would spin on m_InFlight), their buffers are written again here,
+         /// oldest first, so a rewritten O_DIRECT tail block ends up with its latest content.
+         ///
+         void abandonRing()
+         {
+             teardownRing();
+             for (size_t i = 1; i <= FILE_WRITER_BUFFERS; ++i)
+             {
+                 Buffer& pending = m_Buffers[(m_Current + i) % FILE_WRITER_BUFFERS];
+                 if (pending.busy)
+                     writeAt((const char*)pending.iov.iov_base, pending.length, pending.offset);
+                 pending.busy = false;
+             }
+             m_InFlight = 0;
+         }
+#else
+         bool setupRing() { return false; }
+         void teardownRing() { }
+         bool enter(unsigned, unsigned, unsigned) { return true; }
+#endif
+
+         FileWriter(const FileWriter& obj);
+         void operator=(const FileWriter& obj);
+
+      private:
+         int         m_Fd;
+         bool        m_Direct;
+         char*       m_Memory;
+         Buffer      m_Buffers[FILE_WRITER_BUFFERS];
+         size_t      m_Current;      // buffer being filled
+         size_t      m_Fill;
+         size_t      m_Carried;      // bytes at its start that are in the file already (O_DIRECT tail)
+         uint64_t    m_Offset;       // file offset of the current buffer
+         size_t      m_InFlight;
+         Ring        m_Ring;
+         bool        m_Fixed;        // buffers registered with the ring
+    };
+
+} // End of namespace
+
+#endif // End of _FILE_WRITER_H_
@@ -0,0 +1,216 @@
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+// Code Specific Header Files(s)
+#include "SlotRegistry.h"
+#include "WriteFully.h"
+
+namespace CPlusPlusLogging
+{
+    // Bytes of text each thread keeps, see Logger::enableFlightRecorder()
+    #define DEFAULT_FLIGHT_RING_SIZE    (64 * 1024)
+
+    // Threads that can own a ring at the same time; exited threads hand theirs on
+    #define MAX_FLIGHT_RINGS            256
+
+    ///
+    /// One thread's ring of newline terminated lines. Only the owning thread appends, the oldest
+    /// bytes are overwritten. 'head' counts every byte ever appended, so the live window is
+    /// [head - size, head) and a dump only has to remember the head it stopped at.
+    ///
+    struct FlightRing
+    {
+        std::atomic<bool>       owned;      // a live thread appends to it
+        std::atomic<uint64_t>   head;
+        std::atomic<uint64_t>   dumped;     // head claimed by the last dump
+        std::atomic<long>       threadId;
+        size_t                  size;
+        char*                   data;
+
+        explicit FlightRing(size_t bytes) : size(bytes), data(new char[bytes])
+        {
+            threadId.store(0);
+            owned.store(false);
+            head.store(0);
+            dumped.store(0);
+        }
+
+        ~FlightRing()
+        {
+            delete [] data;
+        }
+
+        /// "<timestamp>  <text>\n", or "<text>\n" without a timestamp
+        void appendLine(std::string_view timestamp, std::string_view text)
+        {
+            uint64_t end = head.load(std::memory_order_relaxed);
+            if (!timestamp.empty())
+            {
+                end = put(end, timestamp);
+                end = put(end, std::string_view("  ", 2));
+            }
+            end = put(end, text);
+            end = put(end, std::string_view("\n", 1));
+            head.store(end, std::memory_order_release);
+        }
+
+      private:
+        uint64_t put(uint64_t end, std::string_view text)
+        {
+            const char* bytes  = text.data();
+            size_t      length = text.size();
+            if (length > size)
+            {
+                // Only the tail of a huge record fits
+                bytes += length - size;
+                length = size;
+            }
+
+            const uint64_t from  = end + text.size() - length;
+            const size_t   at    = (size_t)(from % size);
+            const size_t   first = (length < size - at) ? length : size - at;
+            memcpy(data + at, bytes, first);
+            memcpy(data, bytes + first, length - first);
+            return end + text.size();
+        }
+
+        FlightRing(const FlightRing& obj);
+        void operator=(const FlightRing& obj);
+    };
+
+    ///
+    /// The per-thread rings of the flight recorder mode. Appending is a memcpy into the calling
+    /// thread's ring, no lock and no syscall. dump() only uses write(2) on a descriptor opened
+    /// beforehand, so it can run from a signal handler. Rings of other threads are read while
+    /// they may still be appended to, a line at the overwrite edge may come out garbled.
+    ///
+    class FlightRecorder
+    {
+      public:
+         FlightRecorder()
+         {
+             m_RingSize.store(DEFAULT_FLIGHT_RING_SIZE);
+         }
+
+         /// Size of the rings created from now on
+         void setRingSize(size_t bytes) { m_RingSize.store(bytes ? bytes : DEFAULT_FLIGHT_RING_SIZE); }
+
+         ///
+         /// A ring for the calling thread: one left by an exited thread, or a new one.
+         /// NULL once all MAX_FLIGHT_RINGS slots are owned by live threads.
+         ///
+         FlightRing* acquire()
+         {
+             const size_t bytes = m_RingSize.load();
+             FlightRing*  ring  = m_Rings.acquire([bytes] { return new FlightRing(bytes); });
+             if (ring != NULL)
+                 ring->threadId.store(syscall(SYS_gettid), std::memory_order_relaxed);
+             return ring;
+         }
+
+         static void release(FlightRing* ring)
+         {
+             Rings::release(ring);
+         }
+
+         ///
+         /// Writes every line recorded since the previous dump to 'fd', ring by ring, each under a
+         /// header naming its thread. Async-signal-safe.
+         ///
+         void dump(int fd)
+         {
+             m_Rings.forEach([fd](FlightRing* ring) { dumpRing(fd, ring); });
+         }
+
+      private:
+         static void dumpRing(int fd, FlightRing* ring)
+         {
+             const uint64_t head   = ring->head.load(std::memory_order_acquire);
+             const uint64_t oldest = (head > ring->size) ? head - ring->size : 0;
+
+             // The range is claimed first, so two dumps at once (two FATAL records, or an
+             // explicit dump and a crash) never write the same lines twice
+             uint64_t from = ring->dumped.load(std::memory_order_relaxed);
+             do
+             {
+                 if (from >= head)
+                     return;
+             } while (!ring->dumped.compare_exchange_weak(from, head, std::memory_order_relaxed));
+
+             // Overwritten lines start mid-way, skip to the first complete one
+             if (from < oldest)
+             {
+                 from = oldest;
+                 while (from < head && ring->data[from % ring->size] != '\n')
+                     ++from;
+                 ++from;
+                 if (from >= head)
+                     return;
+             }
+
+             char   header[80];
+             size_t length = headerLine(header, ring->threadId.load(std::memory_order_relaxed));
+
+             const size_t start = (size_t)(from % ring->size);
+             const size_t count = (size_t)(head - from);
+             const size_t first = (count < ring->size - start) ? count : ring->size - start;
+
+             struct iovec iov[3];
+             iov[0].iov_base = header;
+             iov[0].iov_len  = length;
+             iov[1].iov_base = ring->data + start;
+             iov[1].iov_len  = first;
+             iov[2].iov_base = ring->data;
+             iov[2].iov_len  = count - first;
+             writeFully(fd, iov, 3);
+         }
+
+         /// "----- flight recorder, thread <tid> -----\n" without snprintf, which is not signal safe
+         static size_t headerLine(char* out, long threadId)
+         {
+             static const char prefix[] = "----- flight recorder, thread ";
+             static const char suffix[] = " -----\n";
+             size_t length = sizeof(prefix) - 1;
+             memcpy(out, prefix, length);
+
+             char digits[24];
+             size_t count = 0;
+             unsigned long value = (unsigned long)threadId;
+             do
+             {
+                 digits[count++] = (char)('0' + value % 10);
+                 value /= 10;
+             } while (value != 0);
+             while (count > 0)
+                 out[length++] = digits[--count];
+
+             memcpy(out + length, suffix, sizeof(suffix) - 1);
+             return length + sizeof(suffix) - 1;
+         }
+
+         typedef SlotRegistry<FlightRing, MAX_FLIGHT_RINGS> Rings;
+
+         FlightRecorder(const FlightRecorder& obj);
+         void operator=(const FlightRecorder& obj);
+
+      private:
+         Rings                       m_Rings;
+         std::atomic<size_t>         m_RingSize;
+    };
+
+} // End of namespace
+
+#endif // End of _FLIGHT_RECORDER_H_
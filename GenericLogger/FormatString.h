@@ -0,0 +1,103 @@
+#ifndef _FORMAT_STRING_H_
+#define _FORMAT_STRING_H_
+
+// C++ Header File(s)
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// A "{}" format string taken apart at compile time: the literal pieces around the
+    /// placeholders, with "{{" and "}}" already turned into single braces. render() is one
+    /// append per piece and one write() per argument, all lengths are constants.
+    ///
+    template <size_t Placeholders, size_t Length>
+    struct CompiledFormat
+    {
+        char    text[Length + 1];
+        size_t  offset[Placeholders + 1];
+        size_t  length[Placeholders + 1];
+
+        constexpr std::string_view piece(size_t i) const { return std::string_view(text + offset[i], length[i]); }
+
+        template <typename... Args>
+        void render(LogFormatter& out, const Args&... args) const
+        {
+            static_assert(sizeof...(Args) == Placeholders, "one argument per {} placeholder");
+            renderPieces(out, std::index_sequence_for<Args...>(), args...);
+        }
+
+      private:
+        template <size_t... I, typename... Args>
+        void renderPieces(LogFormatter& out, std::index_sequence<I...>, const Args&... args) const
+        {
+            ((out.append(piece(I)), out.write(args)), ...);
+            out.append(piece(Placeholders));
+        }
+    };
+
+    ///
+    /// Compile-time parser of the LOG_*_F format strings. Only "{}" placeholders exist, a brace
+    /// that is neither part of one nor doubled makes the string invalid.
+    ///
+    class FormatString
+    {
+      public:
+         /// Number of placeholders, -1 for a malformed string
+         static constexpr long count(std::string_view format)
+         {
+             long placeholders = 0;
+             for (size_t i = 0; i < format.size(); ++i)
+             {
+                 if (format[i] == '{')
+                 {
+                     if (i + 1 < format.size() && format[i + 1] == '{')
+                         ++i;
+                     else if (i + 1 < format.size() && format[i + 1] == '}')
+                         ++i, ++placeholders;
+                     else
+                         return -1;
+                 }
+                 else if (format[i] == '}')
+                 {
+                     if (i + 1 < format.size() && format[i + 1] == '}')
+                         ++i;
+                     else
+                         return -1;
+                 }
+             }
+             return placeholders;
+         }
+
+         template <size_t Placeholders, size_t Length>
+         static constexpr CompiledFormat<Placeholders, Length> compile(std::string_view format)
+         {
+             CompiledFormat<Placeholders, Length> compiled = {};
+             size_t size  = 0;
+             size_t piece = 0;
+             for (size_t i = 0; i < format.size(); ++i)
+             {
+                 if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}')
+                 {
+                     compiled.length[piece] = size - compiled.offset[piece];
+                     compiled.offset[++piece] = size;
+                     ++i;
+                     continue;
+                 }
+                 compiled.text[size++] = format[i];
+                 if (format[i] == '{' || format[i] == '}')
+                     ++i;    // the second brace of "{{" or "}}"
+             }
+             compiled.length[piece] = size - compiled.offset[piece];
+             return compiled;
+         }
+    };
+
+} // End of namespace
+
+#endif // End of _FORMAT_STRING_H_
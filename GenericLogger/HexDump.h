@@ -0,0 +1,163 @@
+#ifndef _HEX_DUMP_H_
+#define _HEX_DUMP_H_
+
+// C++ Header File(s)
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+
+namespace CPlusPlusLogging
+{
+    // Bytes per hexdump line and the length of a rendered line (without '\n'):
+    // "00000000  48 65 6c 6c 6f 20 57 6f  72 6c 64 21 0a 00 01 02  |Hello World!....|"
+    #define HEX_DUMP_ROW        16
+    #define HEX_DUMP_LINE       78
+
+    ///
+    /// Renders raw bytes in "hexdump -C" layout: offset, 16 hex bytes in two groups of 8 and the
+    /// printable ASCII column. Full rows go through a SIMD kernel (SSE2 on x86-64, NEON on ARM)
+    /// that converts all 32 nibbles and the ASCII column of a row at once, the last partial row and
+    /// other targets use the scalar table lookup.
+    ///
+    class HexDump
+    {
+      public:
+         static void render(LogFormatter& out, const void* data, size_t length)
+         {
+             const unsigned char* bytes = (const unsigned char*)data;
+             size_t offset = 0;
+
+             const size_t rows = (length + HEX_DUMP_ROW - 1) / HEX_DUMP_ROW;
+             out.reserve(rows * (HEX_DUMP_LINE + 1));
+
+             // Full rows are written straight into the record, over a copy of a blank row
+             char blank[HEX_DUMP_LINE];
+             clearRow(blank);
+
+             for (; offset + HEX_DUMP_ROW <= length; offset += HEX_DUMP_ROW)
+             {
+                 char* line = out.extend(offset ? HEX_DUMP_LINE + 1 : HEX_DUMP_LINE);
+                 if (line == NULL)
+                     return;
+                 if (offset != 0)
+                     *line++ = '\n';
+                 memcpy(line, blank, HEX_DUMP_LINE);
+
+                 char hex[2 * HEX_DUMP_ROW];
+                 convertRow(bytes + offset, hex, line + ASCII_COLUMN);
+                 writeOffset(line, offset);
+                 for (size_t i = 0; i < HEX_DUMP_ROW; ++i)
+                     memcpy(line + hexColumn(i), hex + 2 * i, 2);
+             }
+
+             if (offset < length)
+             {
+                 // Partial row: pad the missing bytes so the ASCII column stays aligned
+                 const size_t count = length - offset;
+                 char line[HEX_DUMP_LINE + 1];
+                 line[0] = '\n';
+                 clearRow(line + 1);
+                 writeOffset(line + 1, offset);
+                 for (size_t i = 0; i < count; ++i)
+                 {
+                     line[1 + hexColumn(i)]     = digits()[bytes[offset + i] >> 4];
+                     line[1 + hexColumn(i) + 1] = digits()[bytes[offset + i] & 0x0f];
+                     line[1 + ASCII_COLUMN + i] = printable(bytes[offset + i]);
+                 }
+                 line[1 + ASCII_COLUMN + count] = '|';
+                 if (offset == 0)
+                     out.append(line + 1, ASCII_COLUMN + count + 1);
+                 else
+                     out.append(line, ASCII_COLUMN + count + 2);
+             }
+         }
+
+      private:
+         static const char* digits() { return "0123456789abcdef"; }
+
+         static char printable(unsigned char c) { return (c >= 0x20 && c < 0x7f) ? (char)c : '.'; }
+
+         ///
+         /// Hex digits (high nibble first) and ASCII column of one full row
+         ///
+         static void convertRow(const unsigned char* row, char* hex, char* ascii)
+         {
+#if defined(__SSE2__)
+             const __m128i v     = _mm_loadu_si128((const __m128i*)row);
+             const __m128i mask  = _mm_set1_epi8(0x0f);
+             const __m128i hi    = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+             const __m128i lo    = _mm_and_si128(v, mask);
+
+             // n + '0', plus 'a' - '0' - 10 where n > 9
+             const __m128i nine  = _mm_set1_epi8(9);
+             const __m128i zero  = _mm_set1_epi8('0');
+             const __m128i alpha = _mm_set1_epi8('a' - '0' - 10);
+             const __m128i hiHex = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+             const __m128i loHex = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+             _mm_storeu_si128((__m128i*)hex, _mm_unpacklo_epi8(hiHex, loHex));
+             _mm_storeu_si128((__m128i*)(hex + 16), _mm_unpackhi_epi8(hiHex, loHex));
+
+             // Signed compares: bytes from 0x80 up are negative and fail the first one
+             const __m128i shown = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+                                                 _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+             const __m128i dots  = _mm_andnot_si128(shown, _mm_set1_epi8('.'));
+             _mm_storeu_si128((__m128i*)ascii, _mm_or_si128(_mm_and_si128(shown, v), dots));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+             const uint8x16_t v      = vld1q_u8(row);
+             const uint8x16_t hi     = vshrq_n_u8(v, 4);
+             const uint8x16_t lo     = vandq_u8(v, vdupq_n_u8(0x0f));
+             const uint8x16_t nine   = vdupq_n_u8(9);
+             const uint8x16_t zero   = vdupq_n_u8('0');
+             const uint8x16_t alpha  = vdupq_n_u8('a' - '0' - 10);
+             uint8x16x2_t     pairs;
+             pairs.val[0] = vaddq_u8(vaddq_u8(hi, zero), vandq_u8(vcgtq_u8(hi, nine), alpha));
+             pairs.val[1] = vaddq_u8(vaddq_u8(lo, zero), vandq_u8(vcgtq_u8(lo, nine), alpha));
+             vst2q_u8((uint8_t*)hex, pairs);
+
+             const uint8x16_t shown  = vandq_u8(vcgtq_u8(v, vdupq_n_u8(0x1f)), vcltq_u8(v, vdupq_n_u8(0x7f)));
+             vst1q_u8((uint8_t*)ascii, vbslq_u8(shown, v, vdupq_n_u8('.')));
+#else
+             for (size_t i = 0; i < HEX_DUMP_ROW; ++i)
+             {
+                 hex[2 * i]     = digits()[row[i] >> 4];
+                 hex[2 * i + 1] = digits()[row[i] & 0x0f];
+                 ascii[i]       = printable(row[i]);
+             }
+#endif
+         }
+
+         /// Blank line with the separators of the ASCII column
+         static void clearRow(char* line)
+         {
+             memset(line, ' ', HEX_DUMP_LINE);
+             line[ASCII_COLUMN - 1]            = '|';
+             line[ASCII_COLUMN + HEX_DUMP_ROW] = '|';
+         }
+
+         static void writeOffset(char* line, size_t offset)
+         {
+             for (int i = 7; i >= 0; --i)
+             {
+                 line[i] = digits()[offset & 0x0f];
+                 offset >>= 4;
+             }
+         }
+
+         /// "00000000  " then 3 characters per byte, with one more space after the 8th byte
+         static size_t hexColumn(size_t i) { return 10 + 3 * i + (i >= 8 ? 1 : 0); }
+
+         enum { ASCII_COLUMN = 10 + 3 * HEX_DUMP_ROW + 3 };
+    };
+
+} // End of namespace
+
+#endif // End of _HEX_DUMP_H_
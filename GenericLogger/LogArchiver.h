@@ -0,0 +1,204 @@
+#ifndef _LOG_ARCHIVER_H_
+#define _LOG_ARCHIVER_H_
+
+// C++ Header File(s)
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <glob.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace CPlusPlusLogging
+{
+    // enum for how rotated log files are compressed
+    typedef enum LOG_COMPRESSION
+    {
+      COMPRESS_NONE     = 1,        // Rotated files are kept as they are.
+      COMPRESS_GZIP     = 2,        // "gzip", rotated files end in ".gz".
+      COMPRESS_ZSTD     = 3,        // "zstd", rotated files end in ".zst".
+    } LogCompression;
+
+    // Nice value of the compression thread and the compressor it runs
+    #define LOG_ARCHIVER_NICE   19
+
+    ///
+    /// Takes care of rotated log files on a background thread: compresses them and removes the
+    /// oldest ones beyond the retention count. Compression runs the gzip/zstd tool through
+    /// posix_spawnp() from a thread whose nice value is LOG_ARCHIVER_NICE (the child process
+    /// inherits it), so neither the CPU time nor a compression library is on the logging path.
+    ///
+    /// Rotated files are named "<log file>.<YYYYmmdd-HHMMSS.mmm>", which sorts by age.
+    ///
+    class LogArchiver
+    {
+      public:
+         LogArchiver() : m_Compression(COMPRESS_GZIP), m_Keep(0), m_Running(false), m_Stop(false)
+         {
+             pthread_mutex_init(&m_Lock, NULL);
+             pthread_cond_init(&m_Wake, NULL);
+         }
+
+         ~LogArchiver()
+         {
+             stop();
+             pthread_cond_destroy(&m_Wake);
+             pthread_mutex_destroy(&m_Lock);
+         }
+
+         ///
+         /// 'pattern' matches every rotated file (glob syntax), 'keep' == 0 keeps all of them
+         ///
+         void configure(const std::string& pattern, unsigned keep, LogCompression compression)
+         {
+             pthread_mutex_lock(&m_Lock);
+             m_Pattern     = pattern;
+             m_Keep        = keep;
+             m_Compression = compression;
+             pthread_mutex_unlock(&m_Lock);
+         }
+
+         ///
+         /// Queues a freshly rotated file, starting the thread on first use. Never blocks on I/O.
+         ///
+         void submit(const std::string& path)
+         {
+             pthread_mutex_lock(&m_Lock);
+             m_Pending.push_back(path);
+             if (!m_Running)
+             {
+                 m_Stop    = false;
+                 m_Running = (pthread_create(&m_Thread, NULL, &LogArchiver::run, this) == 0);
+             }
+             pthread_cond_signal(&m_Wake);
+             pthread_mutex_unlock(&m_Lock);
+         }
+
+         ///
+         /// Finishes the queued files and stops the thread
+         ///
+         void stop()
+         {
+             pthread_mutex_lock(&m_Lock);
+             const bool running = m_Running;
+             m_Stop = true;
+             pthread_cond_signal(&m_Wake);
+             pthread_mutex_unlock(&m_Lock);
+
+             if (running)
+                 pthread_join(m_Thread, NULL);
+             m_Running = false;
+         }
+
+      private:
+         static void* run(void* arg)
+         {
+             LogArchiver* archiver = static_cast<LogArchiver*>(arg);
+
+             // Linux nice values are per thread, spawned compressors inherit this one
+             setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), LOG_ARCHIVER_NICE);
+
+             pthread_mutex_lock(&archiver->m_Lock);
+             for (;;)
+             {
+                 while (archiver->m_Pending.empty() && !archiver->m_Stop)
+                     pthread_cond_wait(&archiver->m_Wake, &archiver->m_Lock);
+                 if (archiver->m_Pending.empty())
+                     break;
+
+                 std::string    path        = archiver->m_Pending.front();
+                 std::string    pattern     = archiver->m_Pattern;
+                 unsigned       keep        = archiver->m_Keep;
+                 LogCompression compression = archiver->m_Compression;
+                 archiver->m_Pending.pop_front();
+                 pthread_mutex_unlock(&archiver->m_Lock);
+
+                 compress(path, compression);
+                 prune(pattern, keep);
+
+                 pthread_mutex_lock(&archiver->m_Lock);
+             }
+             pthread_mutex_unlock(&archiver->m_Lock);
+             return NULL;
+         }
+
+         ///
+         /// Runs the compressor, which replaces 'path' with its compressed version
+         ///
+         static void compress(const std::string& path, LogCompression compression)
+         {
+             const char* argv[5];
+             if (compression == COMPRESS_GZIP)
+             {
+                 argv[0] = "gzip";  argv[1] = "-q";   argv[2] = path.c_str(); argv[3] = NULL;
+             }
+             else if (compression == COMPRESS_ZSTD)
+             {
+                 argv[0] = "zstd";  argv[1] = "-q";   argv[2] = "--rm"; argv[3] = path.c_str(); argv[4] = NULL;
+             }
+             else
+             {
+                 return;
+             }
+
+             pid_t pid;
+             if (posix_spawnp(&pid, argv[0], NULL, NULL, (char* const*)argv, environ) != 0)
+             {
+                 printf("LogArchiver::compress() -- Unable to run %s, %s stays uncompressed!!\n", argv[0], path.c_str());
+                 return;
+             }
+
+             int status;
+             while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+             {
+             }
+         }
+
+         ///
+         /// Removes the oldest rotated files beyond 'keep'
+         ///
+         static void prune(const std::string& pattern, unsigned keep)
+         {
+             if (keep == 0)
+                 return;
+
+             glob_t found;
+             if (glob(pattern.c_str(), 0, NULL, &found) != 0)
+                 return;
+
+             // glob() sorts, and the timestamped names sort oldest first
+             std::vector<std::string> files(found.gl_pathv, found.gl_pathv + found.gl_pathc);
+             globfree(&found);
+
+             for (size_t i = 0; i + keep < files.size(); ++i)
+                 unlink(files[i].c_str());
+         }
+
+         LogArchiver(const LogArchiver& obj);
+         void operator=(const LogArchiver& obj);
+
+      private:
+         std::string             m_Pattern;
+         LogCompression          m_Compression;
+         unsigned                m_Keep;
+         std::deque<std::string> m_Pending;
+         bool                    m_Running;
+         bool                    m_Stop;
+         pthread_t               m_Thread;
+         pthread_mutex_t         m_Lock;
+         pthread_cond_t          m_Wake;
+    };
+
+} // End of namespace
+
+#endif // End of _LOG_ARCHIVER_H_
@@ -0,0 +1,274 @@
+#ifndef _LOG_FORMATTER_H_
+#define _LOG_FORMATTER_H_
+
+// C++ Header File(s)
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Code Specific Header Files(s)
+#include "LogPool.h"
+
+namespace CPlusPlusLogging
+{
+    // Bytes a record can take before the formatter moves it to the heap
+    #define LOG_FORMAT_INLINE_SIZE 1024
+
+    class LogFormatter;
+
+    namespace LogFormatDetail
+    {
+        ///
+        /// Customisation point for user types: a log_format(LogFormatter&, const T&) that argument
+        /// dependent lookup finds, in the namespace of T or, for third-party types, in
+        /// CPlusPlusLogging, renders the value straight into the record instead of operator<<
+        ///
+        template <typename T, typename = void>
+        struct HasLogFormat : std::false_type { };
+
+        template <typename T>
+        struct HasLogFormat<T, std::void_t<decltype(log_format(std::declval<LogFormatter&>(), std::declval<const T&>()))> >
+            : std::true_type { };
+
+        ///
+        /// Lazy arguments: a callable object taking no arguments (a lambda, std::function, ...)
+        /// is called only when its record is rendered, i.e. after the level and sampling checks
+        /// passed, and its result is logged in its place. It is always called on the logging
+        /// thread before the log call returns, so capturing by reference is safe.
+        ///
+        template <typename T, typename = void>
+        struct IsLazy : std::false_type { };
+
+        template <typename T>
+        struct IsLazy<T, std::enable_if_t<std::is_class<T>::value && !HasLogFormat<T>::value &&
+                                          !std::is_convertible<const T&, std::string_view>::value &&
+                                          std::is_invocable<const T&>::value> >
+            : std::negation<std::is_void<std::invoke_result_t<const T&> > > { };
+    }
+
+    ///
+    /// Builds one log record in an inline buffer that lives on the caller's stack. Every argument
+    /// chained with operator% is rendered as " value," just like the former ostringstream version,
+    /// but integers and floating point values go through std::to_chars and strings are copied
+    /// as-is, so the common types never touch the heap, the stream locale or a stream at all.
+    /// Records larger than LOG_FORMAT_INLINE_SIZE spill to a buffer from the calling thread's
+    /// RecordPool. Callables are rendered lazily and user types can provide a log_format()
+    /// overload, see LogFormatDetail.
+    ///
+    class LogFormatter
+    {
+      public:
+         LogFormatter() : m_Data(m_Inline), m_Size(0), m_Capacity(LOG_FORMAT_INLINE_SIZE) { }
+
+         explicit LogFormatter(std::string_view prefix) : LogFormatter()
+         {
+             append(prefix);
+         }
+
+         ~LogFormatter()
+         {
+             if (m_Data != m_Inline)
+                 RecordPool::deallocate(m_Data);
+         }
+
+         template <typename T>
+         LogFormatter & operator % (T &&a)
+         {
+             append(' ');
+             write(a);
+             append(',');
+             return *this;
+         }
+
+         void append(char c)
+         {
+             if (m_Size == m_Capacity && !grow(1))
+                 return;
+             m_Data[m_Size++] = c;
+         }
+
+         void append(const char* data, size_t length)
+         {
+             if (m_Capacity - m_Size < length && !grow(length))
+                 length = m_Capacity - m_Size;
+             memcpy(m_Data + m_Size, data, length);
+             m_Size += length;
+         }
+
+         void append(std::string_view text) { append(text.data(), text.size()); }
+
+         /// Makes room for 'length' more bytes up front, for records whose size is known
+         void reserve(size_t length)
+         {
+             if (m_Capacity - m_Size < length)
+                 grow(length);
+         }
+
+         /// Appends 'length' bytes for the caller to fill in place. NULL if they cannot be had.
+         char* extend(size_t length)
+         {
+             if (m_Capacity - m_Size < length && !grow(length))
+                 return NULL;
+             char* data = m_Data + m_Size;
+             m_Size += length;
+             return data;
+         }
+
+         /// The finished record. Valid until the formatter goes out of scope.
+         std::string_view view() const { return std::string_view(m_Data, m_Size); }
+         size_t size() const { return m_Size; }
+         void clear() { m_Size = 0; }
+
+         ///
+         /// Renders a single value, without the " value," decoration of operator%
+         ///
+         template <typename T>
+         void write(const T& value)
+         {
+             typedef typename std::decay<T>::type Type;
+
+             if constexpr (LogFormatDetail::IsLazy<Type>::value)
+             {
+                 write(value());
+             }
+             else if constexpr (LogFormatDetail::HasLogFormat<Type>::value)
+             {
+                 log_format(*this, value);
+             }
+             else if constexpr (std::is_same<Type, bool>::value)
+             {
+                 append(value ? '1' : '0');
+             }
+             else if constexpr (std::is_same<Type, char>::value ||
+                                std::is_same<Type, signed char>::value ||
+                                std::is_same<Type, unsigned char>::value)
+             {
+                 append((char)value);
+             }
+             else if constexpr (std::is_integral<Type>::value)
+             {
+                 writeNumber(value);
+             }
+             else if constexpr (std::is_floating_point<Type>::value)
+             {
+                 // Same rendering as the default ostream precision (%g with 6 digits)
+                 writeNumber(value, std::chars_format::general, 6);
+             }
+             else if constexpr (std::is_array<T>::value &&
+                                std::is_same<typename std::remove_cv<typename std::remove_extent<T>::type>::type, char>::value)
+             {
+                 // String literals and char buffers, never read past the array
+                 append(value, strnlen(value, std::extent<T>::value));
+             }
+             else if constexpr (std::is_same<Type, char*>::value || std::is_same<Type, const char*>::value)
+             {
+                 if (value)
+                     append(value, strlen(value));
+                 else
+                     append("(null)", 6);
+             }
+             else if constexpr (std::is_convertible<const T&, std::string_view>::value)
+             {
+                 append(std::string_view(value));
+             }
+             else if constexpr (std::is_pointer<Type>::value)
+             {
+                 if (!value)
+                 {
+                     append('0');
+                     return;
+                 }
+                 append("0x", 2);
+                 writeNumber((uintptr_t)value, 16);
+             }
+             else
+             {
+                 // Anything else goes through its operator<<, straight into this buffer
+                 StreamAdapter adapter(*this);
+                 std::ostream  os(&adapter);
+                 os << value;
+             }
+         }
+
+      private:
+         template <typename T, typename... Options>
+         void writeNumber(T value, Options... options)
+         {
+             // Enough for any 128-bit integer or a %g rendered double
+             const size_t maxChars = 64;
+             if (m_Capacity - m_Size < maxChars && !grow(maxChars))
+                 return;
+
+             std::to_chars_result result = std::to_chars(m_Data + m_Size, m_Data + m_Capacity, value, options...);
+             if (result.ec == std::errc())
+                 m_Size = result.ptr - m_Data;
+         }
+
+         ///
+         /// Makes room for at least 'needed' more bytes. On allocation failure the record is
+         /// truncated, logging never throws.
+         ///
+         bool grow(size_t needed)
+         {
+             size_t capacity = m_Capacity * 2;
+             while (capacity - m_Size < needed)
+                 capacity *= 2;
+
+             char* data = (char*)RecordPool::allocate(capacity);
+             if (data == NULL)
+                 return false;
+
+             memcpy(data, m_Data, m_Size);
+             if (m_Data != m_Inline)
+                 RecordPool::deallocate(m_Data);
+
+             m_Data     = data;
+             m_Capacity = capacity;
+             return true;
+         }
+
+         /// Lets operator<< of user types write into the formatter buffer
+         class StreamAdapter : public std::streambuf
+         {
+           public:
+              explicit StreamAdapter(LogFormatter& fmt) : m_Fmt(fmt) { }
+
+           protected:
+              virtual int_type overflow(int_type c)
+              {
+                  if (c != traits_type::eof())
+                      m_Fmt.append((char)c);
+                  return traits_type::not_eof(c);
+              }
+
+              virtual std::streamsize xsputn(const char* s, std::streamsize n)
+              {
+                  m_Fmt.append(s, (size_t)n);
+                  return n;
+              }
+
+           private:
+              LogFormatter& m_Fmt;
+         };
+
+         LogFormatter(const LogFormatter& obj);
+         void operator=(const LogFormatter& obj);
+
+      private:
+         char*   m_Data;
+         size_t  m_Size;
+         size_t  m_Capacity;
+         char    m_Inline[LOG_FORMAT_INLINE_SIZE];
+    };
+
+} // End of namespace
+
+#endif // End of _LOG_FORMATTER_H_
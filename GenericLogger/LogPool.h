@@ -0,0 +1,293 @@
+#ifndef _LOG_POOL_H_
+#define _LOG_POOL_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "SlotRegistry.h"
+
+namespace CPlusPlusLogging
+{
+    // Block sizes of the record pool: 128 bytes up to 8 KB (header included), in powers of two.
+    // Larger requests go to malloc().
+    #define LOG_POOL_MIN_SHIFT          7
+    #define LOG_POOL_CLASSES            7
+    #define LOG_POOL_MAX_BLOCK          ((size_t)1 << (LOG_POOL_MIN_SHIFT + LOG_POOL_CLASSES - 1))
+
+    // Bytes carved into blocks of one size whenever a thread runs out of them
+    #define LOG_POOL_SLAB_SIZE          (64 * 1024)
+
+    // Threads that can own a pool at the same time; exited threads hand theirs on, further
+    // threads fall back to malloc()
+    #define MAX_POOL_THREADS            256
+
+    class RecordPool;
+
+    ///
+    /// Header in front of every block. The owner and size never change once a slab is carved,
+    /// so any thread can tell where a block goes back to.
+    ///
+    struct PoolBlock
+    {
+        RecordPool*     owner;          // NULL for a block that came from malloc()
+        uint32_t        sizeClass;
+        uint32_t        reserved;       // keeps the payload 16-byte aligned
+    };
+
+    ///
+    /// Per-thread slab allocator for log record storage. A thread allocates from its own free
+    /// lists without any atomic operation. Blocks freed by the thread itself go straight back
+    /// onto them; blocks freed elsewhere, typically a sink thread done with a record, are
+    /// pushed onto the owner's lock-free remote list, and the owner takes the whole list back
+    /// with one exchange when a free list runs dry. FreeBatch hands a whole run of frees back
+    /// with one push per owner.
+    ///
+    /// Pools and slabs are never returned to the system: a pool holds its thread's peak, and an
+    /// exited thread's pool, remote frees included, is adopted by the next new thread.
+    ///
+    class RecordPool
+    {
+      public:
+         static void* allocate(size_t bytes)
+         {
+             const size_t total = bytes + sizeof(PoolBlock);
+             RecordPool*  pool  = (total <= LOG_POOL_MAX_BLOCK) ? current() : NULL;
+             PoolBlock*   block = pool ? pool->take(classOf(total)) : NULL;
+             if (block == NULL)
+             {
+                 block = (PoolBlock*)malloc(total);
+                 if (block == NULL)
+                     return NULL;
+                 block->owner = NULL;
+             }
+             return block + 1;
+         }
+
+         /// From any thread
+         static void deallocate(void* memory)
+         {
+             if (memory == NULL)
+                 return;
+
+             PoolBlock* block = (PoolBlock*)memory - 1;
+             if (block->owner == NULL)
+                 free(block);
+             else if (block->owner == local().pool)
+                 block->owner->putLocal(block);
+             else
+                 block->owner->pushRemote(block, block);
+         }
+
+         ///
+         /// Collects the blocks a thread frees in a row and returns them per owner on flush(),
+         /// so a sink thread draining a queue costs each producer one remote push per batch
+         ///
+         class FreeBatch
+         {
+           public:
+              FreeBatch() : m_Count(0) { }
+              ~FreeBatch() { flush(); }
+
+              void add(void* memory)
+              {
+                  PoolBlock* block = (PoolBlock*)memory - 1;
+                  if (block->owner == NULL)
+                  {
+                      free(block);
+                      return;
+                  }
+
+                  size_t i = 0;
+                  while (i < m_Count && m_Chains[i].owner != block->owner)
+                      ++i;
+                  if (i == m_Count)
+                  {
+                      if (m_Count == CHAINS)
+                      {
+                          flush();
+                          i = 0;
+                      }
+                      m_Chains[i].owner = block->owner;
+                      m_Chains[i].first = NULL;
+                      m_Chains[i].last  = block;
+                      ++m_Count;
+                  }
+                  link(block) = m_Chains[i].first;
+                  m_Chains[i].first = block;
+              }
+
+              void flush()
+              {
+                  for (size_t i = 0; i < m_Count; ++i)
+                      m_Chains[i].owner->pushRemote(m_Chains[i].first, m_Chains[i].last);
+                  m_Count = 0;
+              }
+
+           private:
+              static const size_t CHAINS = 16;
+
+              struct Chain
+              {
+                  RecordPool*   owner;
+                  PoolBlock*    first;
+                  PoolBlock*    last;
+              };
+
+              FreeBatch(const FreeBatch& obj);
+              void operator=(const FreeBatch& obj);
+
+           private:
+              Chain   m_Chains[CHAINS];
+              size_t  m_Count;
+         };
+
+      private:
+         RecordPool()
+         {
+             m_Owned.store(false);
+             m_Remote.store(NULL);
+             for (size_t i = 0; i < LOG_POOL_CLASSES; ++i)
+                 m_Free[i] = NULL;
+         }
+
+         static size_t classOf(size_t total)
+         {
+             if (total <= ((size_t)1 << LOG_POOL_MIN_SHIFT))
+                 return 0;
+             return (size_t)(64 - __builtin_clzll((unsigned long long)(total - 1))) - LOG_POOL_MIN_SHIFT;
+         }
+
+         /// Free blocks are linked through their payload
+         static PoolBlock*& link(PoolBlock* block) { return *(PoolBlock**)(block + 1); }
+
+         PoolBlock* take(size_t sizeClass)
+         {
+             if (m_Free[sizeClass] == NULL)
+             {
+                 reclaimRemote();
+                 if (m_Free[sizeClass] == NULL && !carve(sizeClass))
+                     return NULL;
+             }
+
+             PoolBlock* block = m_Free[sizeClass];
+             m_Free[sizeClass] = link(block);
+             return block;
+         }
+
+         void putLocal(PoolBlock* block)
+         {
+             link(block) = m_Free[block->sizeClass];
+             m_Free[block->sizeClass] = block;
+         }
+
+         void pushRemote(PoolBlock* first, PoolBlock* last)
+         {
+             PoolBlock* head = m_Remote.load(std::memory_order_relaxed);
+             do
+             {
+                 link(last) = head;
+             } while (!m_Remote.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+         }
+
+         /// Owner only. Takes every remotely freed block at once, so there is no ABA to worry about.
+         void reclaimRemote()
+         {
+             PoolBlock* block = m_Remote.exchange(NULL, std::memory_order_acquire);
+             while (block != NULL)
+             {
+                 PoolBlock* next = link(block);
+                 putLocal(block);
+                 block = next;
+             }
+         }
+
+         bool carve(size_t sizeClass)
+         {
+             char* slab = (char*)malloc(LOG_POOL_SLAB_SIZE);
+             if (slab == NULL)
+                 return false;
+             m_Slabs.push_back(slab);
+
+             const size_t size = (size_t)1 << (LOG_POOL_MIN_SHIFT + sizeClass);
+             for (size_t offset = 0; offset + size <= LOG_POOL_SLAB_SIZE; offset += size)
+             {
+                 PoolBlock* block = (PoolBlock*)(slab + offset);
+                 block->owner     = this;
+                 block->sizeClass = (uint32_t)sizeClass;
+                 block->reserved  = 0;
+                 putLocal(block);
+             }
+             return true;
+         }
+
+         /// Set while a live thread allocates from the pool. Declared ahead of the other members, Registry names it.
+         std::atomic<bool>                   m_Owned;
+
+         ///
+         /// The pools of all threads. Never destroyed: blocks may still be freed from static
+         /// destructors and exiting threads after main() returns.
+         ///
+         typedef SlotRegistry<RecordPool, MAX_POOL_THREADS, &RecordPool::m_Owned> Registry;
+
+         static Registry& registry()
+         {
+             static Registry* const instance = new Registry();
+             return *instance;
+         }
+
+         /// Trivially destructible, so it can still be read while the thread's destructors run
+         struct Local
+         {
+             RecordPool*     pool;
+             bool            disabled;       // exited, or no pool was left
+         };
+
+         static Local& local()
+         {
+             static thread_local Local state = { NULL, false };
+             return state;
+         }
+
+         /// Hands the pool on when the thread exits; allocations after that use malloc()
+         struct Releaser
+         {
+             ~Releaser()
+             {
+                 Local& state = local();
+                 if (state.pool)
+                     Registry::release(state.pool);
+                 state.pool     = NULL;
+                 state.disabled = true;
+             }
+         };
+
+         static RecordPool* current()
+         {
+             Local& state = local();
+             if (__builtin_expect(state.pool == NULL, 0) && !state.disabled)
+             {
+                 static thread_local Releaser releaser;
+                 (void)releaser;
+                 state.pool     = registry().acquire([] { return new RecordPool(); });
+                 state.disabled = (state.pool == NULL);
+             }
+             return state.pool;
+         }
+
+         RecordPool(const RecordPool& obj);
+         void operator=(const RecordPool& obj);
+
+      private:
+         PoolBlock*                          m_Free[LOG_POOL_CLASSES];   // owner only
+         std::vector<char*>                  m_Slabs;                    // owner only
+         alignas(64) std::atomic<PoolBlock*> m_Remote;                   // pushed by other threads
+    };
+
+} // End of namespace
+
+#endif // End of _LOG_POOL_H_
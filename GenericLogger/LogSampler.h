@@ -0,0 +1,113 @@
+#ifndef _LOG_SAMPLER_H_
+#define _LOG_SAMPLER_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+namespace CPlusPlusLogging
+{
+    // How often LOG_FIRST_N reports the messages it keeps suppressing
+    #define LOG_SAMPLER_SUMMARY_MS  10000
+
+    ///
+    /// Per call site state of the sampling macros (LOG_EVERY_N, LOG_FIRST_N, LOG_EVERY_MS and
+    /// LOG_RATE_LIMITED). One static instance lives next to each LogSite. It is all atomics,
+    /// zero initialised, so there is no guard variable and no lock.
+    ///
+    /// Every check returns true when the message may be logged. 'skipped' is set to the number of
+    /// messages suppressed since the last report when a "suppressed N similar messages" line is
+    /// due, 0 otherwise.
+    ///
+    struct LogSampler
+    {
+        std::atomic<uint64_t> count;        // calls seen (EVERY_N, FIRST_N)
+        std::atomic<uint64_t> suppressed;   // since the last report
+        std::atomic<uint64_t> stamp;        // last pass (EVERY_MS, FIRST_N) or next free slot (RATE_LIMITED)
+
+        /// Logs the 1st, (n+1)th, (2n+1)th... call. The gaps are implied by n, so no report.
+        bool everyN(uint64_t n, uint64_t& skipped)
+        {
+            skipped = 0;
+            return count.fetch_add(1, std::memory_order_relaxed) % (n ? n : 1) == 0;
+        }
+
+        /// Logs the first n calls, then reports the suppressed ones every LOG_SAMPLER_SUMMARY_MS
+        bool firstN(uint64_t n, uint64_t& skipped)
+        {
+            skipped = 0;
+            if (count.load(std::memory_order_relaxed) < n && count.fetch_add(1, std::memory_order_relaxed) < n)
+            {
+                stamp.store(coarseMs(), std::memory_order_relaxed);
+                return true;
+            }
+
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            uint64_t last = stamp.load(std::memory_order_relaxed);
+            const uint64_t now = coarseMs();
+            if (now - last >= LOG_SAMPLER_SUMMARY_MS && stamp.compare_exchange_strong(last, now, std::memory_order_relaxed))
+                skipped = suppressed.exchange(0, std::memory_order_relaxed);
+            return false;
+        }
+
+        /// Logs at most once per 'ms' milliseconds
+        bool everyMs(uint64_t ms, uint64_t& skipped)
+        {
+            skipped = 0;
+            uint64_t last = stamp.load(std::memory_order_relaxed);
+            const uint64_t now = coarseMs();
+            if ((last != 0 && now - last < ms) || !stamp.compare_exchange_strong(last, now, std::memory_order_relaxed))
+            {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            skipped = suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        ///
+        /// Token bucket of 'burst' tokens refilled at 'perSecond', kept as a single "theoretical
+        /// arrival time" (GCRA) so taking a token is one compare-and-swap
+        ///
+        bool rateLimited(double perSecond, uint64_t burst, uint64_t& skipped)
+        {
+            skipped = 0;
+            const uint64_t interval  = (uint64_t)(1e9 / (perSecond > 0 ? perSecond : 1e-9));
+            const uint64_t tolerance = interval * (burst ? burst - 1 : 0);
+            const uint64_t now       = preciseNs();
+
+            uint64_t next = stamp.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                const uint64_t base = (next > now) ? next : now;
+                if (base - now > tolerance)
+                {
+                    suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (stamp.compare_exchange_weak(next, base + interval, std::memory_order_relaxed))
+                    break;
+            }
+            skipped = suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        static uint64_t coarseMs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+        }
+
+        static uint64_t preciseNs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+    };
+
+} // End of namespace
+
+#endif // End of _LOG_SAMPLER_H_
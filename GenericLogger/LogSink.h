@@ -0,0 +1,337 @@
+#ifndef _LOG_SINK_H_
+#define _LOG_SINK_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// Code Specific Header Files(s)
+#include "LogPool.h"
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// One formatted record, shared by every sink it is fanned out to. The text is formatted once,
+    /// header and characters live in a single block of the producer's RecordPool, and the last
+    /// release() hands it back.
+    ///
+    class LogLine
+    {
+      public:
+         /// The record starts with one reference, owned by the caller
+         static LogLine* create(int level, std::string_view timestamp, std::string_view text)
+         {
+             const size_t stampLength = timestamp.size();
+             const size_t length      = stampLength + (stampLength ? 2 : 0) + text.size();
+
+             void* memory = RecordPool::allocate(sizeof(LogLine) + length);
+             if (memory == NULL)
+                 return NULL;
+
+             LogLine* line = new (memory) LogLine(level, stampLength, length);
+             char*    data = (char*)(line + 1);
+             if (stampLength)
+             {
+                 memcpy(data, timestamp.data(), stampLength);
+                 data[stampLength]     = ' ';
+                 data[stampLength + 1] = ' ';
+             }
+             memcpy(data + length - text.size(), text.data(), text.size());
+             return line;
+         }
+
+         void retain() const { m_Refs.fetch_add(1, std::memory_order_relaxed); }
+
+         void release() const
+         {
+             if (m_Refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+             {
+                 this->~LogLine();
+                 RecordPool::deallocate((void*)this);
+             }
+         }
+
+         /// Same, but a freed block joins 'freed' and goes back to its pool with the batch
+         void release(RecordPool::FreeBatch& freed) const
+         {
+             if (m_Refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+             {
+                 this->~LogLine();
+                 freed.add((void*)this);
+             }
+         }
+
+         /// A LOG_LEVEL value
+         int level() const { return m_Level; }
+
+         /// "<timestamp>  <message>", or only the message for buffer records
+         std::string_view text() const { return std::string_view((const char*)(this + 1), m_Length); }
+         std::string_view message() const { return text().substr(m_StampLength ? m_StampLength + 2 : 0); }
+
+      private:
+         LogLine(int level, size_t stampLength, size_t length)
+           : m_Refs(1), m_Level(level), m_StampLength(stampLength), m_Length(length)
+         {
+         }
+
+         ~LogLine() {}
+
+         LogLine(const LogLine& obj);
+         void operator=(const LogLine& obj);
+
+      private:
+         mutable std::atomic<uint32_t>   m_Refs;
+         int                             m_Level;
+         size_t                          m_StampLength;
+         size_t                          m_Length;
+    };
+
+    ///
+    /// Destination of the records fanned out by Logger::addSink(). Every sink gets its own
+    /// queue and thread, write() and flush() are only ever called from that thread.
+    ///
+    class LogSink
+    {
+      public:
+         virtual ~LogSink() {}
+
+         /// One record, without the trailing newline
+         virtual void write(const LogLine& line) = 0;
+
+         /// Called once the queue is empty, after a run of write() calls and on Logger::flush()
+         virtual void flush() {}
+
+         /// Called on every wake up of the sink thread (at least once per millisecond), also
+         /// when nothing was queued, e.g. to retry a connection
+         virtual void idle() {}
+    };
+
+    ///
+    /// Standard output, one writev() per record
+    ///
+    class ConsoleSink : public LogSink
+    {
+      public:
+         virtual void write(const LogLine& line)
+         {
+             const std::string_view text = line.text();
+             struct iovec iov[2];
+             iov[0].iov_base = (void*)text.data();
+             iov[0].iov_len  = text.size();
+             iov[1].iov_base = (void*)"\n";
+             iov[1].iov_len  = 1;
+             if (writev(STDOUT_FILENO, iov, 2) < 0)
+             {
+                 // Nowhere to report a failing console
+             }
+         }
+    };
+
+    ///
+    /// Appends to a file of its own. Records collect in memory and go out with one write()
+    /// per run of records, so a busy sink costs few syscalls.
+    ///
+    class FileSink : public LogSink
+    {
+      public:
+         explicit FileSink(const std::string& path)
+         {
+             m_Fd = ::open(path.c_str(), O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0644);
+             if (m_Fd < 0)
+                 printf("FileSink::FileSink() -- Unable to open %s!!\n", path.c_str());
+         }
+
+         virtual ~FileSink()
+         {
+             flush();
+             if (m_Fd >= 0)
+                 ::close(m_Fd);
+         }
+
+         bool isOpen() const { return m_Fd >= 0; }
+
+         virtual void write(const LogLine& line)
+         {
+             m_Pending.append(line.text().data(), line.text().size());
+             m_Pending.append(1, '\n');
+             if (m_Pending.size() >= 64 * 1024)
+                 flush();
+         }
+
+         virtual void flush()
+         {
+             size_t done = 0;
+             while (m_Fd >= 0 && done < m_Pending.size())
+             {
+                 const ssize_t n = ::write(m_Fd, m_Pending.data() + done, m_Pending.size() - done);
+                 if (n < 0 && errno == EINTR)
+                     continue;
+                 if (n <= 0)
+                     break;
+                 done += (size_t)n;
+             }
+             m_Pending.clear();
+         }
+
+      private:
+         int         m_Fd;
+         std::string m_Pending;
+    };
+
+    ///
+    /// Local syslog daemon. The datagrams ("<PRI>ident[pid]: message") are sent straight to
+    /// /dev/log, which also keeps <syslog.h> and its LOG_INFO/LOG_DEBUG macros out of the way
+    /// of ours. The daemon adds its own timestamp, so only the message part is sent.
+    ///
+    class SyslogSink : public LogSink
+    {
+      public:
+         /// 'facility' is the syslog facility number (1 = user, 16..23 = local0..local7)
+         explicit SyslogSink(const std::string& ident, int facility = 1)
+           : m_Ident(ident), m_Facility(facility)
+         {
+             m_Fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+             memset(&m_Address, 0, sizeof(m_Address));
+             m_Address.sun_family = AF_UNIX;
+             strncpy(m_Address.sun_path, "/dev/log", sizeof(m_Address.sun_path) - 1);
+         }
+
+         virtual ~SyslogSink()
+         {
+             if (m_Fd >= 0)
+                 ::close(m_Fd);
+         }
+
+         virtual void write(const LogLine& line)
+         {
+             if (m_Fd < 0)
+                 return;
+
+             char header[64];
+             const int length = snprintf(header, sizeof(header), "<%d>%.32s[%d]: ",
+                                         m_Facility * 8 + severity(line.level()), m_Ident.c_str(), (int)getpid());
+
+             const std::string_view message = line.message();
+             struct iovec iov[2];
+             iov[0].iov_base = header;
+             iov[0].iov_len  = (size_t)length;
+             iov[1].iov_base = (void*)message.data();
+             iov[1].iov_len  = message.size();
+
+             struct msghdr msg;
+             memset(&msg, 0, sizeof(msg));
+             msg.msg_name    = &m_Address;
+             msg.msg_namelen = sizeof(m_Address);
+             msg.msg_iov     = iov;
+             msg.msg_iovlen  = 2;
+             if (sendmsg(m_Fd, &msg, MSG_DONTWAIT|MSG_NOSIGNAL) < 0)
+             {
+                 // No daemon or its queue is full, the record is dropped
+             }
+         }
+
+      private:
+         /// LOG_LEVEL to syslog severity
+         static int severity(int level)
+         {
+             switch (level)
+             {
+                 case 1:  return 2;     // FATAL: critical
+                 case 2:  return 3;     // ERROR: error
+                 case 3:  return 4;     // WARNING: warning
+                 case 4:  return 6;     // INFO: informational
+                 default: return (level < 0) ? 5 : 7;    // ALWAYS: notice, the rest: debug
+             }
+         }
+
+      private:
+         std::string         m_Ident;
+         int                 m_Facility;
+         int                 m_Fd;
+         struct sockaddr_un  m_Address;
+    };
+
+    ///
+    /// Keeps the newest 'capacity' records in memory, e.g. for tests or a diagnostics page.
+    /// The records themselves are shared, not copied.
+    ///
+    class MemorySink : public LogSink
+    {
+      public:
+         explicit MemorySink(size_t capacity) : m_Capacity(capacity ? capacity : 1)
+         {
+             pthread_mutex_init(&m_Lock, NULL);
+         }
+
+         virtual ~MemorySink()
+         {
+             clear();
+             pthread_mutex_destroy(&m_Lock);
+         }
+
+         virtual void write(const LogLine& line)
+         {
+             line.retain();
+             pthread_mutex_lock(&m_Lock);
+             m_Lines.push_back(&line);
+             const LogLine* oldest = NULL;
+             if (m_Lines.size() > m_Capacity)
+             {
+                 oldest = m_Lines.front();
+                 m_Lines.pop_front();
+             }
+             pthread_mutex_unlock(&m_Lock);
+
+             if (oldest)
+                 oldest->release();
+         }
+
+         /// Copy of the kept records, oldest first. Safe to call from any thread.
+         std::vector<std::string> lines()
+         {
+             pthread_mutex_lock(&m_Lock);
+             std::vector<std::string> copy;
+             copy.reserve(m_Lines.size());
+             for (size_t i = 0; i < m_Lines.size(); ++i)
+                 copy.push_back(std::string(m_Lines[i]->text()));
+             pthread_mutex_unlock(&m_Lock);
+             return copy;
+         }
+
+         void clear()
+         {
+             pthread_mutex_lock(&m_Lock);
+             std::deque<const LogLine*> lines;
+             lines.swap(m_Lines);
+             pthread_mutex_unlock(&m_Lock);
+
+             for (size_t i = 0; i < lines.size(); ++i)
+                 lines[i]->release();
+         }
+
+      private:
+         size_t                      m_Capacity;
+         std::deque<const LogLine*>  m_Lines;
+         pthread_mutex_t             m_Lock;
+    };
+
+} // End of namespace
+
+#endif // End of _LOG_SINK_H_
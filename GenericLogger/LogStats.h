@@ -0,0 +1,438 @@
+#ifndef _LOG_STATS_H_
+#define _LOG_STATS_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+#include "SlotRegistry.h"
+
+namespace CPlusPlusLogging
+{
+    // enum for where the periodic stats report goes, see Logger::enableStats()
+    typedef enum STATS_REPORT
+    {
+      STATS_REPORT_NONE       = 1,  // Only Logger::stats() snapshots.
+      STATS_REPORT_LOG        = 2,  // An INFO record with the counters and latency percentiles.
+      STATS_REPORT_PROMETHEUS = 3,  // Prometheus text exposition, rewritten in place (node_exporter textfile collector).
+    } StatsReport;
+
+    // Threads that can own a counter block at the same time; exited threads hand theirs on
+    #define MAX_STATS_THREADS           256
+
+    // Record counters: ALWAYS, FATAL .. BUFFER, and one for every other level
+    #define LOG_STATS_LEVELS            9
+
+    // Latency histogram layout: 2^SUB_BITS linear sub-buckets per power of two (12.5% wide),
+    // nanosecond values up to 2^MAX_BITS (about 18 minutes), larger ones land in the last bucket
+    #define LATENCY_SUB_BITS            3
+    #define LATENCY_MAX_BITS            40
+    #define LATENCY_BUCKETS             ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+    ///
+    /// A counter with a single writer: add() is a plain load and store, no locked instruction,
+    /// the atomic only makes the concurrent reads of a snapshot well defined.
+    ///
+    struct StatsCounter
+    {
+        std::atomic<uint64_t> value;
+
+        StatsCounter() { value.store(0); }
+
+        void add(uint64_t n)
+        {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+
+    ///
+    /// Bucket arithmetic shared by the live histograms and the snapshots. Values below
+    /// 2^SUB_BITS get a bucket each, every power of two above is split into 2^SUB_BITS buckets.
+    ///
+    struct LatencyBuckets
+    {
+        static size_t index(uint64_t ns)
+        {
+            if (ns < (1u << LATENCY_SUB_BITS))
+                return (size_t)ns;
+
+            const unsigned exponent = 63 - __builtin_clzll(ns);
+            if (exponent >= LATENCY_MAX_BITS)
+                return LATENCY_BUCKETS - 1;
+            const unsigned shift = exponent - LATENCY_SUB_BITS;
+            return ((size_t)(shift + 1) << LATENCY_SUB_BITS) + (size_t)((ns >> shift) & ((1u << LATENCY_SUB_BITS) - 1));
+        }
+
+        /// Largest value that falls into 'bucket', the last one takes everything from 2^MAX_BITS up
+        static uint64_t upperBound(size_t bucket)
+        {
+            if (bucket < (1u << LATENCY_SUB_BITS))
+                return bucket;
+            if (bucket >= LATENCY_BUCKETS - 1)
+                return UINT64_MAX;
+
+            const unsigned shift = (unsigned)(bucket >> LATENCY_SUB_BITS) - 1;
+            const uint64_t sub   = bucket & ((1u << LATENCY_SUB_BITS) - 1);
+            return (((1u << LATENCY_SUB_BITS) + sub + 1) << shift) - 1;
+        }
+    };
+
+    ///
+    /// Summed copy of the per-thread histograms, see LogStats
+    ///
+    struct LatencySnapshot
+    {
+        uint64_t count;
+        uint64_t sumNs;
+        uint64_t maxNs;
+        uint64_t buckets[LATENCY_BUCKETS];
+
+        LatencySnapshot() : count(0), sumNs(0), maxNs(0) { memset(buckets, 0, sizeof(buckets)); }
+
+        uint64_t meanNs() const { return count ? sumNs / count : 0; }
+
+        /// Upper bound of the bucket holding the 'q' quantile (0.99 for p99), capped at the maximum
+        uint64_t percentileNs(double q) const
+        {
+            if (count == 0)
+                return 0;
+
+            uint64_t rank = (uint64_t)(q * (double)count + 0.5);
+            if (rank == 0)
+                rank = 1;
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < LATENCY_BUCKETS; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= rank)
+                {
+                    const uint64_t bound = LatencyBuckets::upperBound(i);
+                    return (bound < maxNs) ? bound : maxNs;
+                }
+            }
+            return maxNs;
+        }
+
+        /// Values at or below 'ns', to bucket resolution
+        uint64_t countAtMost(uint64_t ns) const
+        {
+            uint64_t total = 0;
+            for (size_t i = 0; i < LATENCY_BUCKETS && LatencyBuckets::upperBound(i) <= ns; ++i)
+                total += buckets[i];
+            return total;
+        }
+    };
+
+    ///
+    /// HDR-style latency histogram of one thread, written by that thread only
+    ///
+    struct LatencyHistogram
+    {
+        StatsCounter    count;
+        StatsCounter    sumNs;
+        StatsCounter    maxNs;
+        StatsCounter    buckets[LATENCY_BUCKETS];
+
+        void record(uint64_t ns)
+        {
+            buckets[LatencyBuckets::index(ns)].add(1);
+            count.add(1);
+            sumNs.add(ns);
+            if (ns > maxNs.get())
+                maxNs.value.store(ns, std::memory_order_relaxed);
+        }
+
+        void addTo(LatencySnapshot& snapshot) const
+        {
+            snapshot.count += count.get();
+            snapshot.sumNs += sumNs.get();
+            if (maxNs.get() > snapshot.maxNs)
+                snapshot.maxNs = maxNs.get();
+            for (size_t i = 0; i < LATENCY_BUCKETS; ++i)
+                snapshot.buckets[i] += buckets[i].get();
+        }
+
+        static uint64_t nowNs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+        }
+    };
+
+    ///
+    /// Records the time until it goes out of scope, does nothing for a NULL histogram
+    ///
+    class LatencyTimer
+    {
+      public:
+         explicit LatencyTimer(LatencyHistogram* histogram)
+           : m_Histogram(histogram), m_Start(histogram ? LatencyHistogram::nowNs() : 0) { }
+
+         ~LatencyTimer()
+         {
+             if (m_Histogram)
+                 m_Histogram->record(LatencyHistogram::nowNs() - m_Start);
+         }
+
+      private:
+         LatencyTimer(const LatencyTimer& obj);
+         void operator=(const LatencyTimer& obj);
+
+      private:
+         LatencyHistogram*   m_Histogram;
+         uint64_t            m_Start;
+    };
+
+    ///
+    /// The counters one thread keeps about its own logging. Blocks are handed on when a thread
+    /// exits and never cleared, so the sum over all blocks is the total since stats were first
+    /// enabled.
+    ///
+    struct ThreadStats
+    {
+        std::atomic<bool>   owned;
+        StatsCounter        records[LOG_STATS_LEVELS];
+        StatsCounter        bytesWritten;
+        StatsCounter        flushes;            // stream flushes and writev() runs reaching the OS
+        StatsCounter        droppedNewest;      // by the queues' overflow policy
+        StatsCounter        droppedOldest;
+        StatsCounter        blocked;            // records that had to wait for room
+        LatencyHistogram    enqueueLatency;     // caller side, hand over to the backend
+        LatencyHistogram    writeLatency;       // the flushes and writes themselves
+
+        ThreadStats() { owned.store(false); }
+
+        static size_t levelIndex(int level)
+        {
+            if (level < 0)
+                return 0;                       // ALWAYS_LOG_THIS
+            return (level >= 1 && level <= 7) ? (size_t)level : LOG_STATS_LEVELS - 1;
+        }
+
+      private:
+        ThreadStats(const ThreadStats& obj);
+        void operator=(const ThreadStats& obj);
+    };
+
+    ///
+    /// Point-in-time copy of the logger's counters, returned by Logger::stats(). The per-thread
+    /// blocks are read while their threads keep counting, so the fields are not one atomic cut.
+    ///
+    struct LogStats
+    {
+        uint64_t            records[LOG_STATS_LEVELS];
+        uint64_t            bytesWritten;
+        uint64_t            flushes;
+        uint64_t            droppedNewest;
+        uint64_t            droppedOldest;
+        uint64_t            blocked;
+        uint64_t            queueDepth;         // asynchronous queue, right now
+        uint64_t            queueHighWater;     // asynchronous queue, deepest so far
+        uint64_t            sinkQueueHighWater; // deepest of all sink queues so far
+        uint64_t            threads;            // counter blocks in use
+        LatencySnapshot     enqueueLatency;
+        LatencySnapshot     writeLatency;
+
+        LogStats()
+          : bytesWritten(0), flushes(0), droppedNewest(0), droppedOldest(0), blocked(0),
+            queueDepth(0), queueHighWater(0), sinkQueueHighWater(0), threads(0)
+        {
+            memset(records, 0, sizeof(records));
+        }
+
+        uint64_t totalRecords() const
+        {
+            uint64_t total = 0;
+            for (size_t i = 0; i < LOG_STATS_LEVELS; ++i)
+                total += records[i];
+            return total;
+        }
+
+        void add(const ThreadStats& block)
+        {
+            for (size_t i = 0; i < LOG_STATS_LEVELS; ++i)
+                records[i] += block.records[i].get();
+            bytesWritten  += block.bytesWritten.get();
+            flushes       += block.flushes.get();
+            droppedNewest += block.droppedNewest.get();
+            droppedOldest += block.droppedOldest.get();
+            blocked       += block.blocked.get();
+            block.enqueueLatency.addTo(enqueueLatency);
+            block.writeLatency.addTo(writeLatency);
+            ++threads;
+        }
+
+        static std::string_view levelName(size_t index)
+        {
+            static const char* const names[LOG_STATS_LEVELS] =
+                { "always", "fatal", "error", "warning", "info", "debug", "trace", "buffer", "other" };
+            return names[index];
+        }
+
+        ///
+        /// "records=.. info=.. bytes=.. ... enqueue_p99_ns=.." as logfmt pairs, for the periodic
+        /// log record
+        ///
+        void summary(LogFormatter& out) const
+        {
+            out.append("records=");
+            out.write(totalRecords());
+            for (size_t i = 0; i < LOG_STATS_LEVELS; ++i)
+            {
+                if (records[i] == 0)
+                    continue;
+                out.append(' ');
+                out.append(levelName(i));
+                out.append('=');
+                out.write(records[i]);
+            }
+            pair(out, "bytes", bytesWritten);
+            pair(out, "flushes", flushes);
+            pair(out, "dropped_newest", droppedNewest);
+            pair(out, "dropped_oldest", droppedOldest);
+            pair(out, "blocked", blocked);
+            pair(out, "queue_depth", queueDepth);
+            pair(out, "queue_high_water", queueHighWater);
+            pair(out, "sink_queue_high_water", sinkQueueHighWater);
+            latencySummary(out, "enqueue", enqueueLatency);
+            latencySummary(out, "write", writeLatency);
+        }
+
+        /// Prometheus text exposition format, version 0.0.4
+        void prometheus(LogFormatter& out) const
+        {
+            header(out, "logger_records_total", "Records logged, by level.", "counter");
+            for (size_t i = 0; i < LOG_STATS_LEVELS; ++i)
+            {
+                out.append("logger_records_total{level=\"");
+                out.append(levelName(i));
+                out.append("\"} ");
+                out.write(records[i]);
+                out.append('\n');
+            }
+
+            metric(out, "logger_bytes_written_total", "Bytes handed to the log outputs.", "counter", bytesWritten);
+            metric(out, "logger_flushes_total", "Buffered output handed to the OS.", "counter", flushes);
+
+            header(out, "logger_dropped_total", "Records dropped by the queue overflow policy.", "counter");
+            out.append("logger_dropped_total{policy=\"drop_newest\"} ");
+            out.write(droppedNewest);
+            out.append("\nlogger_dropped_total{policy=\"drop_oldest\"} ");
+            out.write(droppedOldest);
+            out.append('\n');
+
+            metric(out, "logger_blocked_total", "Records that waited for room in a full queue.", "counter", blocked);
+            metric(out, "logger_queue_depth", "Records in the asynchronous queue.", "gauge", queueDepth);
+            metric(out, "logger_queue_high_water", "Deepest the asynchronous queue has been.", "gauge", queueHighWater);
+            metric(out, "logger_sink_queue_high_water", "Deepest any sink queue has been.", "gauge", sinkQueueHighWater);
+
+            histogram(out, "logger_enqueue_latency_seconds", "Time a log call takes to hand its record over.", enqueueLatency);
+            histogram(out, "logger_write_latency_seconds", "Time of the flushes and writes to the outputs.", writeLatency);
+        }
+
+      private:
+        static void pair(LogFormatter& out, std::string_view key, uint64_t value)
+        {
+            out.append(' ');
+            out.append(key);
+            out.append('=');
+            out.write(value);
+        }
+
+        static void latencySummary(LogFormatter& out, std::string_view name, const LatencySnapshot& latency)
+        {
+            static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+            static const char* const keys[] = { "_p50_ns=", "_p90_ns=", "_p99_ns=", "_p999_ns=" };
+            for (size_t i = 0; i < 4; ++i)
+            {
+                out.append(' ');
+                out.append(name);
+                out.append(keys[i]);
+                out.write(latency.percentileNs(quantiles[i]));
+            }
+            out.append(' ');
+            out.append(name);
+            out.append("_max_ns=");
+            out.write(latency.maxNs);
+        }
+
+        static void header(LogFormatter& out, std::string_view name, std::string_view help, std::string_view type)
+        {
+            out.append("# HELP ");
+            out.append(name);
+            out.append(' ');
+            out.append(help);
+            out.append("\n# TYPE ");
+            out.append(name);
+            out.append(' ');
+            out.append(type);
+            out.append('\n');
+        }
+
+        static void metric(LogFormatter& out, std::string_view name, std::string_view help,
+                           std::string_view type, uint64_t value)
+        {
+            header(out, name, help, type);
+            out.append(name);
+            out.append(' ');
+            out.write(value);
+            out.append('\n');
+        }
+
+        /// Cumulative buckets on a 1-2.5-5 series from 100ns to 10s
+        static void histogram(LogFormatter& out, std::string_view name, std::string_view help,
+                              const LatencySnapshot& latency)
+        {
+            static const char* const bounds[] =
+                { "1e-07", "2.5e-07", "5e-07", "1e-06", "2.5e-06", "5e-06", "1e-05", "2.5e-05", "5e-05",
+                  "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+                  "0.1", "0.25", "0.5", "1", "2.5", "5", "10" };
+            static const uint64_t boundsNs[] =
+                { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+                  100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+                  100000000, 250000000, 500000000, 1000000000, 2500000000u, 5000000000u, 10000000000u };
+
+            header(out, name, help, "histogram");
+            for (size_t i = 0; i < sizeof(boundsNs) / sizeof(boundsNs[0]); ++i)
+            {
+                out.append(name);
+                out.append("_bucket{le=\"");
+                out.append(bounds[i]);
+                out.append("\"} ");
+                out.write(latency.countAtMost(boundsNs[i]));
+                out.append('\n');
+            }
+            out.append(name);
+            out.append("_bucket{le=\"+Inf\"} ");
+            out.write(latency.count);
+            out.append('\n');
+
+            out.append(name);
+            out.append("_sum ");
+            out.write((double)latency.sumNs / 1e9);
+            out.append('\n');
+            out.append(name);
+            out.append("_count ");
+            out.write(latency.count);
+            out.append('\n');
+        }
+    };
+
+    ///
+    /// The per-thread counter blocks: a thread takes a free block on first use and releases it
+    /// when it exits, stats() sums all of them
+    ///
+    typedef SlotRegistry<ThreadStats, MAX_STATS_THREADS> StatsRegistry;
+
+} // End of namespace
+
+#endif // End of _LOG_STATS_H_
@@ -1,6 +1,7 @@
 // C++ Header File(s)
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
 // Code Specific Header Files(s)
@@ -9,6 +10,18 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <execinfo.h>
+#include <limits.h>
+#include <sched.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/uio.h>
 
 using namespace std;
 using namespace CPlusPlusLogging;
@@ -18,29 +31,240 @@ Logger* Logger::m_Instance = 0;
 // Log file name. File name should be change from here only
 const string logFileName = LOG_FILE_NAME;
 
-// Tags that are logged as per user's will
-#define ALWAYS_TAG "[ALWAYS]: "
-#define FATAL_TAG "[FATAL]: "
-#define ERROR_TAG "[ERROR]: "
-#define WARNING_TAG "[WARNING]: "
-#define INFO_TAG "[INFO]: "
-#define DEBUG_TAG "[DEBUG]: "
-#define TRACE_TAG "[TRACE]: "
+// Every logger by index, getInstance() is slot 0. Filled under g_LoggersMutex and never cleared,
+// so the crash handler and atexit() can walk it without a lock.
+static std::atomic<Logger*> g_Loggers[MAX_LOGGERS];
+static pthread_mutex_t      g_LoggersMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Level generations are unique across loggers, so a call site's cached level can never pass
+// for the level of another logger
+static std::atomic<uint64_t> g_LevelGeneration(0);
+
+// Signals of the crash handler and the actions the application had installed for them, which
+// the handler passes the signal on to
+static const int        g_CrashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM };
+static const size_t     CRASH_SIGNAL_COUNT = sizeof(g_CrashSignals) / sizeof(g_CrashSignals[0]);
+static struct sigaction g_PreviousActions[CRASH_SIGNAL_COUNT];
+
+static uint64_t nextGeneration()
+{
+   return g_LevelGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+///
+/// Owns the calling thread's batch buffers, one per logger. When the thread exits a buffer is
+/// only marked retired, the writer thread frees it once its last lines are written.
+///
+struct ThreadBufferOwner
+{
+   ThreadBuffer* buffer[MAX_LOGGERS];
+
+   ~ThreadBufferOwner()
+   {
+      for(size_t i = 0; i < MAX_LOGGERS; ++i)
+      {
+         if(buffer[i])
+         {
+            pthread_mutex_lock(&buffer[i]->lock);
+            buffer[i]->retired = true;
+            pthread_mutex_unlock(&buffer[i]->lock);
+         }
+      }
+   }
+};
+
+static thread_local ThreadBufferOwner t_BufferOwner;
+
+///
+/// The calling thread's flight recorder rings, one per logger, handed on to the next thread
+/// when this one exits
+///
+struct FlightRingOwner
+{
+   FlightRing* ring[MAX_LOGGERS];
+
+   ~FlightRingOwner()
+   {
+      for(size_t i = 0; i < MAX_LOGGERS; ++i)
+      {
+         if(ring[i])
+            FlightRecorder::release(ring[i]);
+      }
+   }
+};
+
+static thread_local FlightRingOwner t_FlightRing;
+
+///
+/// The calling thread's stats counters, one block per logger, handed on to the next thread
+/// when this one exits
+///
+struct StatsOwner
+{
+   ThreadStats* block[MAX_LOGGERS];
+
+   ~StatsOwner()
+   {
+      for(size_t i = 0; i < MAX_LOGGERS; ++i)
+      {
+         if(block[i])
+            StatsRegistry::release(block[i]);
+      }
+   }
+};
+
+static thread_local StatsOwner t_Stats;
+
+///
+/// Coarse monotonic clock for the flush interval, a vDSO read without a syscall
+///
+static uint64_t monotonicMs()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+   return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+///
+/// Wall-clock seconds for the rotation interval
+///
+static uint64_t realtimeSec()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+   return (uint64_t)ts.tv_sec;
+}
+
+///
+/// Kernel thread id of the caller. gettid() is a syscall, every thread asks once.
+///
+static long currentThreadId()
+{
+   static thread_local long threadId = syscall(SYS_gettid);
+   return threadId;
+}
+
+///
+/// Spin-wait hint, lets the sibling hyper-thread run while BACKOFF_SPIN finds nothing to do
+///
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__)
+   asm volatile("yield");
+#endif
+}
+
+///
+/// Absolute CLOCK_REALTIME deadline 'us' microseconds from now, for pthread_cond_timedwait()
+///
+static struct timespec deadlineIn(uint64_t us)
+{
+   struct timeval  now;
+   struct timespec deadline;
+   gettimeofday(&now, NULL);
+   const uint64_t nsec = ((uint64_t)now.tv_usec + us) * 1000;
+   deadline.tv_sec  = now.tv_sec + (time_t)(nsec / 1000000000);
+   deadline.tv_nsec = (long)(nsec % 1000000000);
+   return deadline;
+}
 
 ///
 /// Creates the instance + initializes default log type/level +mutex variables
 ///
-Logger::Logger()
+Logger::Logger() : Logger(std::string(), logFileName, 0)
+{
+}
+
+///
+/// A named logger writing to 'fileName', 'index' is its slot in the logger registry
+///
+Logger::Logger(const std::string& name, const std::string& fileName, size_t index)
+   : m_Name(name), m_FileName(fileName), m_Index(index)
 {
-   m_File.open(logFileName.c_str(), ios::out|ios::app);
-   m_LogLevel	= LOG_LEVEL_TRACE;
-   m_LogType	= FILE_LOG;
+   // A large stream buffer, flushed by the flush policy instead of std::endl
+   m_FileBuffer = new char[DEFAULT_FILE_BUFFER_SIZE];
+   m_File.rdbuf()->pubsetbuf(m_FileBuffer, DEFAULT_FILE_BUFFER_SIZE);
+   m_File.open(m_FileName.c_str(), ios::out|ios::app);
+
+   m_FlushBytes.store(DEFAULT_FLUSH_BYTES);
+   m_FlushIntervalMs.store(DEFAULT_FLUSH_INTERVAL_MS);
+   m_FlushLevel.store(DEFAULT_FLUSH_LEVEL);
+   m_PendingBytes    = 0;
+   m_UrgentPending   = false;
+   m_LastFlushMs     = monotonicMs();
+
+   struct stat st;
+   m_RotateBytes       = 0;
+   m_RotateIntervalSec = 0;
+   m_RotateAt          = 0;
+   m_FileBytes         = (stat(m_FileName.c_str(), &st) == 0) ? (uint64_t)st.st_size : 0;
+   m_LastArchiveMs     = 0;
+
+   m_ConfigLevel.store(LOG_LEVEL_INFO);
+   m_ConfigLoaded.store(false);
+   m_ConfigStamp.tv_sec  = 0;
+   m_ConfigStamp.tv_nsec = 0;
+   m_ConfigSize          = -1;
+   m_ConfigInode         = 0;
+   m_ConfigPollMs        = DEFAULT_CONFIG_POLL_MS;
+   m_ConfigRunning.store(false);
+   m_ConfigWakeFd        = -1;
+   pthread_mutex_init(&m_ConfigMutex, NULL);
+
+   m_LogLevel.store(LOG_LEVEL_TRACE);
+   m_LevelGeneration.store(nextGeneration());
+   pthread_mutex_init(&m_OverrideMutex, NULL);
+   m_LogType.store(FILE_LOG);
+
+   m_Queue          = NULL;
+   m_OverflowPolicy = OVERFLOW_BLOCK;
+   m_AsyncEnabled.store(false);
+   m_WriterRunning.store(false);
+   m_Dropped.store(0);
+   m_FlushRequest.store(0);
+   m_FlushAck.store(0);
+   m_Encoding.store(ENCODE_TEXT);
+   m_Format.store(FORMAT_TEXT);
+   m_BatchEnabled.store(false);
+   m_BatchUrgent.store(false);
+   m_FileBackend    = FILE_BACKEND_WRITEV;
+   m_FileDirect     = false;
+   m_FileSync       = false;
+   m_BatchSize      = DEFAULT_BATCH_BUFFER_SIZE;
+   m_BatchSequenced = false;
+   m_Sequence.store(0);
+   m_BatchFd        = -1;
+   for(size_t i = 0; i < MAX_LOG_SINKS; ++i)
+      m_Sinks[i].store(NULL);
+   m_SinkCount.store(0);
+   m_FlightEnabled.store(false);
+   m_FlightLevel.store(LOG_LEVEL_DEBUG);
+   m_DumpFd       = -1;
+   m_Crashing.store(false);
+   m_Parked.store(0);
+   m_StatsEnabled.store(false);
+   m_QueueDepth.store(0);
+   m_QueueHighWater.store(0);
+   m_SinkHighWater.store(0);
+   m_StatsReport     = STATS_REPORT_NONE;
+   m_StatsIntervalMs = 0;
+   m_StatsRunning.store(false);
+   m_StatsWakeFd     = -1;
+   m_TraceEnabled.store(false);
+   m_TraceLogSpans.store(true);
+   m_Backoff.store(BACKOFF_POLL);
+   m_BackoffSleepUs.store(DEFAULT_WRITER_SLEEP_US);
+   m_WriterIdle.store(false);
+   m_SpaceWaiters.store(0);
 //   mylog(1,"sdfasdf");
 //   mylog(1,"sdfasdf","3","4",5);
    //multiparam_logging(LOG_LEVEL_INFO,"sdfasdf","3",this, 66, "4",5);
 
    // Initialize mutex
    int ret=0;
+   pthread_mutexattr_init(&m_Attr);
    ret = pthread_mutexattr_settype(&m_Attr, PTHREAD_MUTEX_ERRORCHECK_NP);
    if(ret != 0)
    {
@@ -53,17 +277,79 @@ Logger::Logger()
       printf("Logger::Logger() -- Mutex not initialized!!\n");
       exit(0);
    }
+
+   pthread_mutex_init(&m_WakeMutex, NULL);
+   pthread_cond_init(&m_WakeCond, NULL);
+   pthread_cond_init(&m_SpaceCond, NULL);
+   pthread_mutex_init(&m_BatchMutex, NULL);
+   pthread_mutex_init(&m_SinkMutex, NULL);
+   pthread_mutex_init(&m_AffinityMutex, NULL);
 }
 
 Logger::~Logger()
 {
+   // Drain whatever the writer thread has not written yet
+   disableConfigReload();
+   disableStats();
+   disableTraceExport();
+   disableAsyncLog();
+   disableBatchedLog();
+   for(size_t i = 0; i < MAX_LOG_SINKS; ++i)
+   {
+      SinkQueue* sink = m_Sinks[i].load();
+      if(sink)
+         removeSink(sink->sink);
+   }
+   for(size_t i = 0; i < m_RetiredSinks.size(); ++i)
+      delete m_RetiredSinks[i];
    m_File.close();
+   m_BinaryFile.close();
+   m_MappedFile.close();
+   if(m_DumpFd >= 0)
+      close(m_DumpFd);
+   delete [] m_FileBuffer;
+
+   for(size_t i = 0; i < m_ThreadBuffers.size(); ++i)
+      delete m_ThreadBuffers[i];
+   for(size_t i = 0; i < m_SpareBatches.size(); ++i)
+      delete m_SpareBatches[i];
 
+   pthread_mutex_destroy(&m_ConfigMutex);
+   pthread_mutex_destroy(&m_OverrideMutex);
+   pthread_mutex_destroy(&m_BatchMutex);
+   pthread_mutex_destroy(&m_SinkMutex);
+   pthread_mutex_destroy(&m_AffinityMutex);
+   pthread_cond_destroy(&m_SpaceCond);
+   pthread_cond_destroy(&m_WakeCond);
+   pthread_mutex_destroy(&m_WakeMutex);
    pthread_mutexattr_destroy(&m_Attr);
    pthread_mutex_destroy(&m_Mutex);
 }
 
 const LOG_LEVEL Logger::getLogLevel() throw()
+{
+    Logger* logger = getInstance();
+    if (!logger->m_ConfigLoaded.load(std::memory_order_acquire))
+    {
+        // First call parses the file, everybody else reads the cached level
+        pthread_mutex_lock(&logger->m_ConfigMutex);
+        if (!logger->m_ConfigLoaded.load(std::memory_order_relaxed))
+        {
+            LOG_LEVEL log_level;
+            if (readConfigLevel(log_level))
+                logger->m_ConfigLevel.store(log_level, std::memory_order_relaxed);
+            logger->m_ConfigLoaded.store(true, std::memory_order_release);
+        }
+        pthread_mutex_unlock(&logger->m_ConfigMutex);
+    }
+
+    return logger->m_ConfigLevel.load(std::memory_order_relaxed);
+}
+
+///
+/// Parses the settings file. On failure 'level' is left untouched.
+///
+bool Logger::readConfigLevel(LOG_LEVEL& level)
 {
     Utils::ConfigFile _conf;
 
@@ -72,32 +358,213 @@ const LOG_LEVEL Logger::getLogLevel() throw()
         const string settings_path = utils::Utils::getSettingsFilePath();
         _conf = Utils::ConfigFile(settings_path);
 
-        LOG_LEVEL log_level = (LOG_LEVEL)_conf.read<int>("logging_level");
-        return log_level;
-
-        // int f = open(logfile_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        const int value = _conf.read<int>("logging_level");
+        if (value < DISABLE_LOG || value > LOG_LEVEL_ALL)
+        {
+            printf("Logger::getLogLevel() -- logging_level %d is out of range, ignored!!\n", value);
+            return false;
+        }
+        level = (LOG_LEVEL)value;
+        return true;
     }
     catch (const Utils::ConfigFile::file_not_found&)
     {
-        cout <<"\nUnable to read..";
-        // Log to error log
-        // Raise an error exception with message
+        printf("Logger::getLogLevel() -- Unable to read the settings file!!\n");
     }
     catch (...)
     {
-        cout << "External exception..";
+        printf("Logger::getLogLevel() -- External exception!!\n");
+    }
+
+    return false;
+}
+
+///
+/// Re-reads the settings file if it changed since the last call and applies its log level.
+/// Runs on the config thread, or before it is started.
+///
+bool Logger::reloadConfig()
+{
+    struct stat st;
+    if (stat(utils::Utils::getSettingsFilePath().c_str(), &st) != 0)
+        return false;
+
+    if (st.st_mtim.tv_sec == m_ConfigStamp.tv_sec && st.st_mtim.tv_nsec == m_ConfigStamp.tv_nsec &&
+        st.st_size == m_ConfigSize && st.st_ino == m_ConfigInode)
+        return false;
+
+    m_ConfigStamp = st.st_mtim;
+    m_ConfigSize  = st.st_size;
+    m_ConfigInode = st.st_ino;
+
+    LOG_LEVEL log_level;
+    if (!readConfigLevel(log_level))
+        return false;
+
+    pthread_mutex_lock(&m_ConfigMutex);
+    m_ConfigLevel.store(log_level, std::memory_order_relaxed);
+    m_ConfigLoaded.store(true, std::memory_order_release);
+    pthread_mutex_unlock(&m_ConfigMutex);
+
+    setLogLevel(log_level);
+    return true;
+}
+
+///
+/// Starts watching the settings file. The current content is applied right away.
+///
+void Logger::enableConfigReload(unsigned intervalMs)
+{
+    disableConfigReload();
+
+    m_ConfigPollMs = intervalMs;
+    m_ConfigSize   = -1;
+    m_ConfigWakeFd = eventfd(0, EFD_CLOEXEC);
+    reloadConfig();
+
+    m_ConfigRunning.store(true);
+    if (pthread_create(&m_ConfigThread, NULL, &Logger::configThread, this) != 0)
+    {
+        printf("Logger::enableConfigReload() -- Config thread not created!!\n");
+        m_ConfigRunning.store(false);
+        close(m_ConfigWakeFd);
+        m_ConfigWakeFd = -1;
+        return;
+    }
+    pinBackend(m_ConfigThread);
+}
+
+void Logger::disableConfigReload()
+{
+    if (!m_ConfigRunning.load())
+        return;
+
+    m_ConfigRunning.store(false);
+    uint64_t one = 1;
+    if (write(m_ConfigWakeFd, &one, sizeof(one)) < 0)
+    {
+        // The thread still notices within one poll interval
+    }
+    pthread_join(m_ConfigThread, NULL);
+
+    close(m_ConfigWakeFd);
+    m_ConfigWakeFd = -1;
+}
+
+///
+/// Body of the config thread. inotify on the settings directory catches editors that replace
+/// the file by a rename, the periodic mtime check covers file systems without inotify.
+///
+void* Logger::configThread(void* arg)
+{
+    Logger* logger = static_cast<Logger*>(arg);
+
+    const string path = utils::Utils::getSettingsFilePath();
+    const size_t slash = path.rfind('/');
+    const string directory = (slash == string::npos) ? string(".") : path.substr(0, slash + 1);
+
+    int watch = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    if (watch >= 0 && inotify_add_watch(watch, directory.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE|IN_ATTRIB) < 0)
+    {
+        close(watch);
+        watch = -1;
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd     = logger->m_ConfigWakeFd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = watch;
+    fds[1].events = POLLIN;
+
+    while (logger->m_ConfigRunning.load())
+    {
+        poll(fds, 2, (int)logger->m_ConfigPollMs);
+
+        // Events are only a hint, the stamp check decides
+        char events[4096];
+        while (watch >= 0 && read(watch, events, sizeof(events)) > 0)
+        {
+        }
+
+        if (logger->m_ConfigRunning.load())
+            logger->reloadConfig();
     }
 
-    return LOG_LEVEL_INFO;
+    if (watch >= 0)
+        close(watch);
+    return NULL;
+}
+
+///
+/// Runs once, from the local static initialisation in getInstance()
+///
+Logger* Logger::createInstance()
+{
+   pthread_mutex_lock(&g_LoggersMutex);
+   m_Instance = new Logger();
+   publish(m_Instance);
+   pthread_mutex_unlock(&g_LoggersMutex);
+   return m_Instance;
+}
+
+///
+/// Looks up a named logger, creating it on the first call
+///
+Logger* Logger::get(const std::string& name, const std::string& fileName)
+{
+   if(name.empty())
+      return getInstance();
+
+   pthread_mutex_lock(&g_LoggersMutex);
+   Logger* logger = NULL;
+   size_t  free   = MAX_LOGGERS;
+   for(size_t i = 1; i < MAX_LOGGERS && logger == NULL; ++i)
+   {
+      Logger* slot = g_Loggers[i].load(std::memory_order_relaxed);
+      if(slot != NULL && slot->m_Name == name)
+         logger = slot;
+      else if(slot == NULL && free == MAX_LOGGERS)
+         free = i;
+   }
+
+   if(logger == NULL && free != MAX_LOGGERS)
+   {
+      logger = new Logger(name, fileName.empty() ? name + ".log" : fileName, free);
+      publish(logger);
+   }
+   pthread_mutex_unlock(&g_LoggersMutex);
+
+   if(logger == NULL)
+   {
+      printf("Logger::get() -- No room for logger %s, using the default logger!!\n", name.c_str());
+      return getInstance();
+   }
+   return logger;
 }
 
-Logger* Logger::getInstance() throw ()
+///
+/// Called with g_LoggersMutex held. Loggers are never deleted, make sure buffered records
+/// reach their files.
+///
+void Logger::publish(Logger* logger)
 {
-   if (m_Instance == 0)
+   static bool atExit = false;
+   if(!atExit)
    {
-      m_Instance = new Logger();
+      atexit(&Logger::flushAtExit);
+      atExit = true;
+   }
+   g_Loggers[logger->m_Index].store(logger, std::memory_order_release);
+}
+
+void Logger::flushAtExit()
+{
+   for(size_t i = 0; i < MAX_LOGGERS; ++i)
+   {
+      Logger* logger = g_Loggers[i].load(std::memory_order_acquire);
+      if(logger != NULL)
+         logger->flush();
    }
-   return m_Instance;
 }
 
 ///
@@ -106,50 +573,202 @@ Logger* Logger::getInstance() throw ()
 ///
 void Logger::buffer_log(LOG_LEVEL level, const char* text) throw()
 {
-    if (m_LogLevel < level) //LOG_LEVEL_BUFFER
+    if (!isEnabled(level)) //LOG_LEVEL_BUFFER
         return;
 
     log_direct_buffer(text);
 }
 
+///
+/// Renders a byte buffer as a hexdump, one buffer record spanning several lines
+///
+void Logger::buffer_dump(const void* data, size_t length) throw()
+{
+    format dump;
+    HexDump::render(dump, data, length);
+    log_direct_buffer(dump.view());
+}
+
+///
+/// Logs the bytes of a buffer unchanged
+///
+void Logger::buffer_raw(const void* data, size_t length) throw()
+{
+    log_direct_buffer(std::string_view((const char*)data, length));
+}
+
 ///
 /// User based logging for plain text logging.
 ///
-void Logger::user_log(LOG_LEVEL level, std::string pretty_func, std::string func_name, const char* text) throw()
+void Logger::user_log(const LogSite* site, const char* text) throw()
+{
+   if (!isEnabled(*site))
+       return;
+
+   log_message(site, text);
+}
+
+///
+/// One finished message of a call site, in the current encoding and format
+///
+void Logger::log_message(const LogSite* site, std::string_view text) throw()
 {
-   if (m_LogLevel < level)
+   if (m_Encoding.load(std::memory_order_relaxed) != ENCODE_TEXT && m_AsyncEnabled.load(std::memory_order_acquire))
+   {
+       const LogType type = logType();
+       if (type == NO_LOG)
+           return;
+
+       format entry;
+       BinaryEncoder::beginEntry(entry, site, BinaryEncoder::now());
+       BinaryEncoder::putString(entry, ARG_TEXT, text);
+       enqueue(type, site->level, std::string_view(), entry.view(), true);
        return;
+   }
+
+   const LogFormat logFormat = m_Format.load(std::memory_order_relaxed);
+   if (logFormat != FORMAT_TEXT)
+   {
+       format record;
+       beginStructured(record, site, logFormat);
+       if (logFormat == FORMAT_JSON)
+       {
+           record.append(",\"msg\":", 7);
+           StructuredFormat::jsonString(record, text);
+           record.append('}');
+       }
+       else
+       {
+           record.append(" msg=", 5);
+           StructuredFormat::logfmtString(record, text);
+       }
+       log_direct_buffer(record.view(), site->level);
+       return;
+   }
+
+   format fmt(site->prefixView());
+   fmt.append(text);
+
+   log_direct(site->level, fmt.view());
+}
 
-   string data;
-   data.append(getLogTypeTag(level));
-   data.append(utils::Utils::className(pretty_func));
-   data.append("::");
-   data.append(func_name);
-   data.append("() - ");
-   data.append(text);
+///
+/// Opening fields of a structured record: time, the site's pre-escaped fields and the thread id
+///
+void Logger::beginStructured(format& record, const LogSite* site, LogFormat logFormat)
+{
+   char   stamp[TIMESTAMP_MAX_LENGTH];
+   size_t length = m_Timestamp.now(stamp);
+
+   if (logFormat == FORMAT_JSON)
+   {
+       record.append("{\"time\":\"", 9);
+       record.append(stamp, length);
+       record.append("\",", 2);
+       record.append(site->jsonView());
+       record.append(",\"thread\":", 10);
+   }
+   else
+   {
+       record.append("time=\"", 6);
+       record.append(stamp, length);
+       record.append("\" ", 2);
+       record.append(site->logfmtView());
+       record.append(" thread=", 8);
+   }
+   record.write(currentThreadId());
+}
 
-   log_direct(data);
+///
+/// Summary line of a sampled call site, logged with the site's own prefix
+///
+void Logger::log_suppressed(const LogSite* site, uint64_t count) throw()
+{
+   char text[64];
+   snprintf(text, sizeof(text), "suppressed %llu similar messages", (unsigned long long)count);
+   user_log(site, (const char*)text);
 }
 
 ///
 /// Returns the log type tag for logging purpose
 ///
-std::string Logger::getLogTypeTag(LOG_LEVEL level)
+const char* Logger::getLogTypeTag(LOG_LEVEL level)
 {
-    switch (level)
-    {
-        case ALWAYS_LOG_THIS:   return ALWAYS_TAG;
-        case LOG_LEVEL_FATAL:   return FATAL_TAG;
-        case LOG_LEVEL_ERROR:   return ERROR_TAG;
-        case LOG_LEVEL_WARNING: return WARNING_TAG;
-        case LOG_LEVEL_INFO:    return INFO_TAG;
-        case LOG_LEVEL_DEBUG:   return DEBUG_TAG;
-        case LOG_LEVEL_TRACE:   return TRACE_TAG;
+    // Tags are string literals, so the view is NUL terminated
+    return LogSite::levelTag(level).data();
+}
 
-        case LOG_LEVEL_BUFFER:
-        case LOG_LEVEL_ALL:
-        default: return EMPTY_STR;
-    }
+///
+/// One span of LOG_SCOPE/LOG_TIMED
+///
+void Logger::log_span(const LogSite* site, std::string_view name, uint64_t startNs, uint64_t durationNs) throw()
+{
+   if (m_TraceEnabled.load(std::memory_order_relaxed))
+   {
+       m_Trace.complete(name, site->className, startNs, durationNs, currentThreadId());
+       if (!m_TraceLogSpans.load(std::memory_order_relaxed))
+           return;
+   }
+
+   const LogFormat logFormat = m_Format.load(std::memory_order_relaxed);
+   const bool      encoded   = m_Encoding.load(std::memory_order_relaxed) != ENCODE_TEXT &&
+                               m_AsyncEnabled.load(std::memory_order_acquire);
+   if (logFormat != FORMAT_TEXT && !encoded)
+   {
+       format record;
+       beginStructured(record, site, logFormat);
+       if (logFormat == FORMAT_JSON)
+       {
+           record.append(",\"span\":", 8);
+           StructuredFormat::jsonString(record, name);
+           record.append(",\"dur_ns\":", 10);
+           record.write(durationNs);
+           record.append('}');
+       }
+       else
+       {
+           record.append(" span=", 6);
+           StructuredFormat::logfmtString(record, name);
+           record.append(" dur_ns=", 8);
+           record.write(durationNs);
+       }
+       log_direct_buffer(record.view(), site->level);
+       return;
+   }
+
+   format message;
+   message.append(name);
+   message.append(" took ", 6);
+   TraceExport::writeMicros(message, durationNs);
+   message.append("us", 2);
+   log_message(site, message.view());
+}
+
+///
+/// Opens the trace file, spans logged from now on are exported
+///
+bool Logger::enableTraceExport(const std::string& path, bool logSpans)
+{
+   disableTraceExport();
+   if (!m_Trace.open(path))
+   {
+       printf("Logger::enableTraceExport() -- Unable to open %s!!\n", path.c_str());
+       return false;
+   }
+
+   m_TraceLogSpans.store(logSpans, std::memory_order_relaxed);
+   m_TraceEnabled.store(true, std::memory_order_relaxed);
+   return true;
+}
+
+///
+/// Writes the pending events and completes the trace file
+///
+void Logger::disableTraceExport()
+{
+   m_TraceEnabled.store(false, std::memory_order_relaxed);
+   m_TraceLogSpans.store(true, std::memory_order_relaxed);
+   m_Trace.close();
 }
 
 ///
@@ -171,66 +790,399 @@ void Logger::unlock()
 ///
 /// A generic function where string data to be logged along with the desired log type
 /// can be provided. This logs into a text file or console.
-void Logger::log_direct(std::string data) throw()
+void Logger::log_direct(LOG_LEVEL level, std::string_view data) throw()
 {
-    if(m_LogType == FILE_LOG)
+    ThreadStats* stats = threadStats();
+    LatencyTimer timer(stats ? &stats->enqueueLatency : NULL);
+    if(stats)
+       stats->records[ThreadStats::levelIndex(level)].add(1);
+
+    if(LOG_UNLIKELY(m_FlightEnabled.load(std::memory_order_relaxed)) && toFlightRecorder(level, data, true))
+       return;
+
+    if(m_SinkCount.load(std::memory_order_acquire) != 0)
+    {
+       char   stamp[TIMESTAMP_MAX_LENGTH];
+       size_t length = m_Timestamp.now(stamp);
+       fanOut(level, std::string_view(stamp, length), data);
+    }
+
+    const LogType type = logType();
+    if(m_BatchEnabled.load(std::memory_order_acquire))
+    {
+       if(type == NO_LOG)
+          return;
+
+       char   stamp[TIMESTAMP_MAX_LENGTH];
+       size_t length = m_Timestamp.now(stamp);
+       appendToBatch(type, level, std::string_view(stamp, length), data);
+    }
+    else if(m_AsyncEnabled.load(std::memory_order_acquire))
+    {
+       if(type == NO_LOG)
+          return;
+
+       // Timestamp is taken on the caller's thread, I/O happens on the writer thread
+       char   stamp[TIMESTAMP_MAX_LENGTH];
+       size_t length = m_Timestamp.now(stamp);
+       enqueue(type, level, std::string_view(stamp, length), data);
+    }
+    else if(type == FILE_LOG)
+    {
+       logIntoFile(level, data);
+    }
+    else if(type == CONSOLE)
     {
-       logIntoFile(data);
+       logOnConsole(level, data);
     }
-    else if(m_LogType == CONSOLE)
+    else if(type == MMAP_FILE_LOG)
     {
-       logOnConsole(data);
+       char   stamp[TIMESTAMP_MAX_LENGTH];
+       size_t length = m_Timestamp.now(stamp);
+       logIntoMappedFile(std::string_view(stamp, length), data);
     }
 }
 
 ///
 /// A generic function for logging into buffer directly..
-void Logger::log_direct_buffer(const char* text) throw()
+void Logger::log_direct_buffer(std::string_view text, LOG_LEVEL level) throw()
 {
-    if(m_LogType == FILE_LOG)
+    ThreadStats* stats = threadStats();
+    LatencyTimer timer(stats ? &stats->enqueueLatency : NULL);
+    if(stats)
+       stats->records[ThreadStats::levelIndex(level)].add(1);
+
+    if(LOG_UNLIKELY(m_FlightEnabled.load(std::memory_order_relaxed)) && level != LOG_LEVEL_BUFFER &&
+       toFlightRecorder(level, text, false))
+       return;
+
+    if(m_SinkCount.load(std::memory_order_acquire) != 0)
+       fanOut(level, std::string_view(), text);
+
+    const LogType type = logType();
+    if(m_BatchEnabled.load(std::memory_order_acquire))
     {
+       if(type == NO_LOG)
+          return;
+
+       appendToBatch(type, level, std::string_view(), text);
+    }
+    else if(m_AsyncEnabled.load(std::memory_order_acquire))
+    {
+       if(type == NO_LOG)
+          return;
+
+       enqueue(type, level, std::string_view(), text);
+    }
+    else if(type == FILE_LOG)
+    {
+       countBytes(text.size() + 1);
        lock();
-       m_File << text << endl;
+       m_File << text << '\n';
+       m_PendingBytes += text.size() + 1;
+       m_FileBytes    += text.size() + 1;
+       const uint64_t now = monotonicMs();
+       if(fileFlushDue(level <= m_FlushLevel.load(std::memory_order_relaxed), now))
+          flushFile(now);
+       rotateIfDue();
        unlock();
     }
-    else if(m_LogType == CONSOLE)
+    else if(type == CONSOLE)
+    {
+       countBytes(text.size() + 1);
+       LatencyTimer writeTimer(stats ? &stats->writeLatency : NULL);
+       if(stats)
+          stats->flushes.add(1);
+       m_Console.writeLine(level, std::string_view(), text);
+    }
+    else if(type == MMAP_FILE_LOG)
     {
-       cout << text << endl;
+       logIntoMappedFile(std::string_view(), text);
     }
 }
 ///
 /// This logs into a text file.
 ///
-void Logger::logIntoFile(std::string& data)
+void Logger::logIntoFile(LOG_LEVEL level, std::string_view data)
 {
+   char   stamp[TIMESTAMP_MAX_LENGTH];
+   size_t length = m_Timestamp.now(stamp);
+   const size_t written = length + 2 + data.size() + 1;
+   countBytes(written);
+
    lock();
-   m_File << utils::Utils::getCurrentTime() << "  " << data << endl;
+   m_File.write(stamp, length) << "  " << data << '\n';
+   m_PendingBytes += written;
+   m_FileBytes    += written;
+   const uint64_t now = monotonicMs();
+   if(fileFlushDue(level <= m_FlushLevel.load(std::memory_order_relaxed), now))
+      flushFile(now);
+   rotateIfDue();
    unlock();
 }
 
 ///
-/// This logs into the console/ terminal where the application executes.
+/// True when the flush policy asks for the pending file output to be flushed
 ///
-void Logger::logOnConsole(std::string& data)
+bool Logger::fileFlushDue(bool urgent, uint64_t now) const
 {
-   cout << utils::Utils::getCurrentTime() << "  " << data << endl;
+   if(m_PendingBytes == 0)
+      return false;
+
+   return urgent || m_PendingBytes >= m_FlushBytes.load(std::memory_order_relaxed) ||
+          now - m_LastFlushMs >= m_FlushIntervalMs.load(std::memory_order_relaxed);
 }
 
-///
-/// Interface to set/update the log level. Thus the log level can be updated
-/// at runtime.
-///
-void Logger::setLogLevel(LogLevel logLevel)
+void Logger::flushFile(uint64_t now)
 {
-   m_LogLevel = logLevel;
+   parkIfCrashing();
+   ThreadStats* stats = (m_PendingBytes != 0) ? threadStats() : NULL;
+   {
+      LatencyTimer writeTimer(stats ? &stats->writeLatency : NULL);
+      m_File.flush();
+      if(m_BinaryFile.is_open())
+         m_BinaryFile.flush();
+      if(m_BatchWriter.isOpen())
+         m_BatchWriter.flush(m_FileSync);
+   }
+   if(stats)
+      stats->flushes.add(1);
+
+   m_PendingBytes  = 0;
+   m_UrgentPending = false;
+   m_LastFlushMs   = now;
 }
 
 ///
-/// Interface to set/update the log type. Namely file or console type.
+/// Rotates the log file when the rotation policy asks for it. Called with m_Mutex held.
 ///
-void Logger::setLogType(LogType logType)
+void Logger::rotateIfDue()
 {
-   m_LogType = logType;
+   bool due = (m_RotateBytes != 0 && m_FileBytes >= m_RotateBytes);
+
+   if(m_RotateIntervalSec != 0)
+   {
+      const uint64_t now = realtimeSec();
+      if(now >= m_RotateAt)
+      {
+         m_RotateAt = (now / m_RotateIntervalSec + 1) * m_RotateIntervalSec;
+         due = due || m_FileBytes > 0;
+      }
+   }
+
+   if(due)
+      rotateFile();
+}
+
+///
+/// Moves the current log file aside and carries on in a new one. The rename keeps the open
+/// descriptors valid, so the old file is flushed before and closed after the new one is
+/// in place. Compression is left to the archiver thread.
+///
+void Logger::rotateFile()
+{
+   flushFile(monotonicMs());
+
+   const string archive = archiveName();
+   m_FileBytes = 0;
+   if(rename(m_FileName.c_str(), archive.c_str()) != 0)
+   {
+      printf("Logger::rotateFile() -- Unable to rename %s, retrying on the next trigger!!\n", m_FileName.c_str());
+      return;
+   }
+
+   m_File.close();
+   m_File.rdbuf()->pubsetbuf(m_FileBuffer, DEFAULT_FILE_BUFFER_SIZE);
+   m_File.open(m_FileName.c_str(), ios::out|ios::app);
+
+   if(m_BatchWriter.isOpen())
+   {
+      if(m_BatchWriter.reopen(m_FileName))
+         m_BatchFd = m_BatchWriter.fd();
+   }
+   else if(m_BatchFd >= 0)
+   {
+      int fd = open(m_FileName.c_str(), O_WRONLY|O_APPEND|O_CREAT, 0644);
+      if(fd >= 0)
+      {
+         close(m_BatchFd);
+         m_BatchFd = fd;
+      }
+   }
+
+   m_Archiver.submit(archive);
+}
+
+///
+/// Name of the next rotated file. Names are unique and sort by age.
+///
+string Logger::archiveName()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_REALTIME, &ts);
+   uint64_t ms = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+   if(ms <= m_LastArchiveMs)
+      ms = m_LastArchiveMs + 1;
+   m_LastArchiveMs = ms;
+
+   time_t    seconds = (time_t)(ms / 1000);
+   struct tm utc;
+   gmtime_r(&seconds, &utc);
+
+   char suffix[32];
+   size_t length = strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &utc);
+   snprintf(suffix + length, sizeof(suffix) - length, ".%03u", (unsigned)(ms % 1000));
+   return m_FileName + suffix;
+}
+
+///
+/// Interface to set up log rotation
+///
+void Logger::setRotationPolicy(size_t maxBytes, unsigned intervalSec, unsigned keep, LogCompression compression)
+{
+   m_Archiver.configure(m_FileName + ".[0-9]*", keep, compression);
+
+   lock();
+   m_RotateBytes       = maxBytes;
+   m_RotateIntervalSec = intervalSec;
+   m_RotateAt          = intervalSec ? (realtimeSec() / intervalSec + 1) * intervalSec : 0;
+   unlock();
+}
+
+///
+/// This logs into the console/ terminal where the application executes. The whole line goes
+/// out with one write(), so no lock is needed.
+///
+void Logger::logOnConsole(LOG_LEVEL level, std::string_view data)
+{
+   char   stamp[TIMESTAMP_MAX_LENGTH];
+   size_t length = m_Timestamp.now(stamp);
+
+   ThreadStats* stats = threadStats();
+   LatencyTimer writeTimer(stats ? &stats->writeLatency : NULL);
+   if(stats)
+      stats->flushes.add(1);
+   countBytes(m_Console.writeLine(level, std::string_view(stamp, length), data));
+}
+
+///
+/// This copies the record straight into the mapped log file, no lock and no syscall.
+///
+void Logger::logIntoMappedFile(std::string_view timestamp, std::string_view data)
+{
+   format line;
+   line.append(timestamp);
+   if(!timestamp.empty())
+      line.append("  ", 2);
+   line.append(data);
+   line.append('\n');
+
+   std::string_view record = line.view();
+   countBytes(record.size());
+   m_MappedFile.write(record.data(), record.size());
+}
+
+///
+/// Interface to set/update the log level. Thus the log level can be updated
+/// at runtime.
+///
+void Logger::setLogLevel(LogLevel logLevel)
+{
+   m_LogLevel.store(logLevel, std::memory_order_relaxed);
+   m_LevelGeneration.store(nextGeneration(), std::memory_order_release);
+}
+
+///
+/// Interface to set/update the log level of a single class or source file
+///
+void Logger::setClassLogLevel(const std::string& name, LogLevel logLevel)
+{
+   pthread_mutex_lock(&m_OverrideMutex);
+   m_LevelOverrides[name] = logLevel;
+   m_LevelGeneration.store(nextGeneration(), std::memory_order_release);
+   pthread_mutex_unlock(&m_OverrideMutex);
+}
+
+void Logger::clearClassLogLevel(const std::string& name)
+{
+   pthread_mutex_lock(&m_OverrideMutex);
+   m_LevelOverrides.erase(name);
+   m_LevelGeneration.store(nextGeneration(), std::memory_order_release);
+   pthread_mutex_unlock(&m_OverrideMutex);
+}
+
+void Logger::clearClassLogLevels()
+{
+   pthread_mutex_lock(&m_OverrideMutex);
+   m_LevelOverrides.clear();
+   m_LevelGeneration.store(nextGeneration(), std::memory_order_release);
+   pthread_mutex_unlock(&m_OverrideMutex);
+}
+
+///
+/// Slow path of isEnabled(const LogSite&): works out the site's level and caches it in the
+/// site. The generation is read first, so a change racing with this call leaves a stale
+/// generation behind and the next check resolves again.
+///
+LOG_LEVEL Logger::resolveLevel(const LogSite& site)
+{
+   pthread_mutex_lock(&m_OverrideMutex);
+   const uint64_t generation = m_LevelGeneration.load(std::memory_order_acquire);
+   LOG_LEVEL      level      = m_LogLevel.load(std::memory_order_relaxed);
+
+   if(!m_LevelOverrides.empty())
+   {
+      const char* slash = strrchr(site.file, '/');
+      const string fileName(slash ? slash + 1 : site.file);
+
+      unordered_map<string, LogLevel>::const_iterator it = m_LevelOverrides.find(string(site.className));
+      if(site.className.empty() || it == m_LevelOverrides.end())
+         it = m_LevelOverrides.find(fileName);
+      if(it != m_LevelOverrides.end())
+         level = it->second;
+   }
+   pthread_mutex_unlock(&m_OverrideMutex);
+
+   site.levelCache.store((generation << 8) | (uint8_t)(int8_t)level, std::memory_order_relaxed);
+   return level;
+}
+
+///
+/// Interface to set/update the log type. Namely file or console type.
+///
+void Logger::setLogType(LogType logType)
+{
+   if(logType == MMAP_FILE_LOG && !m_MappedFile.isOpen())
+   {
+      // Whatever m_File still buffers goes first, the mapping starts at the end of the file
+      flush();
+      if(!m_MappedFile.open(m_FileName))
+      {
+         printf("Logger::setLogType() -- Unable to map %s, keeping the current log type!!\n", m_FileName.c_str());
+         return;
+      }
+   }
+
+   if(logType == CONSOLE)
+      m_Console.detect();
+
+   const LogType previous = m_LogType.exchange(logType, std::memory_order_acq_rel);
+
+   if(previous == MMAP_FILE_LOG && logType != MMAP_FILE_LOG)
+   {
+      // Queued records still go to the mapping, then it is cut to its real length
+      flush();
+      m_MappedFile.close();
+   }
+}
+
+///
+/// Interface to set the level colours of the console output
+///
+void Logger::setConsoleColor(ConsoleColor mode)
+{
+   m_Console.detect();
+   m_Console.setColor(mode);
 }
 
 ///
@@ -238,7 +1190,7 @@ void Logger::setLogType(LogType logType)
 ///
 void Logger::enableAllLog()
 {
-   m_LogLevel = LOG_LEVEL_ALL;
+   setLogLevel(LOG_LEVEL_ALL);
 }
 
 ///
@@ -246,6 +1198,1688 @@ void Logger::enableAllLog()
 ///
 void Logger:: disableLog()
 {
-   m_LogLevel = DISABLE_LOG;
+   setLogLevel(DISABLE_LOG);
+}
+
+///
+/// Starts the writer thread. From here on log_direct/log_direct_buffer only push
+/// pre-formatted records into the queue.
+///
+void Logger::enableAsyncLog(size_t capacity, OverflowPolicy policy)
+{
+   disableAsyncLog();
+   disableBatchedLog();
+
+   m_Queue          = new RingBuffer<LogRecord>(capacity);
+   m_OverflowPolicy = policy;
+
+   if(!startWriter())
+   {
+      printf("Logger::enableAsyncLog() -- Writer thread not created, staying synchronous!!\n");
+      delete m_Queue;
+      m_Queue = NULL;
+      return;
+   }
+
+   m_AsyncEnabled.store(true, std::memory_order_release);
+}
+
+///
+/// Stops the writer thread after it has drained the queue. Logging continues synchronously.
+///
+void Logger::disableAsyncLog()
+{
+   if(!m_AsyncEnabled.load())
+      return;
+
+   m_AsyncEnabled.store(false, std::memory_order_release);
+   stopWriter();
+
+   delete m_Queue;
+   m_Queue = NULL;
+   m_QueueDepth.store(0, std::memory_order_relaxed);
+}
+
+///
+/// Starts the writer thread for batched mode. Lines already sitting in the stream
+/// buffers are flushed first, so they stay ahead of the batches.
+///
+void Logger::enableBatchedLog(size_t bufferSize, bool sequenced)
+{
+   disableAsyncLog();
+   disableBatchedLog();
+
+   // Whatever m_File still buffers goes first, the file writer starts at the end of the file
+   lock();
+   m_File.flush();
+   unlock();
+
+   if(m_FileBackend != FILE_BACKEND_WRITEV)
+      m_BatchFd = m_BatchWriter.open(m_FileName, m_FileBackend, m_FileDirect) ? m_BatchWriter.fd() : -1;
+   else
+      m_BatchFd = open(m_FileName.c_str(), O_WRONLY|O_APPEND|O_CREAT, 0644);
+   if(m_BatchFd < 0)
+   {
+      printf("Logger::enableBatchedLog() -- Unable to open %s, staying synchronous!!\n", m_FileName.c_str());
+      return;
+   }
+
+   m_BatchSize      = bufferSize;
+   m_BatchSequenced = sequenced;
+
+   if(!startWriter())
+   {
+      printf("Logger::enableBatchedLog() -- Writer thread not created, staying synchronous!!\n");
+      if(m_BatchWriter.isOpen())
+         m_BatchWriter.close();
+      else
+         close(m_BatchFd);
+      m_BatchFd = -1;
+      return;
+   }
+
+   m_BatchEnabled.store(true, std::memory_order_release);
+}
+
+///
+/// Stops the writer thread after it has written every thread's pending lines
+///
+void Logger::disableBatchedLog()
+{
+   if(!m_BatchEnabled.load())
+      return;
+
+   m_BatchEnabled.store(false, std::memory_order_release);
+   stopWriter();
+
+   if(m_BatchWriter.isOpen())
+      m_BatchWriter.close();
+   else
+      close(m_BatchFd);
+   m_BatchFd = -1;
+}
+
+///
+/// Interface to choose how the batched mode writes the log file
+///
+void Logger::setFileBackend(FileBackend backend, bool direct, bool syncOnFlush)
+{
+   m_FileBackend = backend;
+   m_FileDirect  = direct;
+   m_FileSync    = syncOnFlush;
+}
+
+bool Logger::startWriter()
+{
+   m_WriterRunning.store(true);
+   if(pthread_create(&m_Writer, NULL, &Logger::writerThread, this) != 0)
+   {
+      m_WriterRunning.store(false);
+      return false;
+   }
+   pinBackend(m_Writer);
+   return true;
+}
+
+void Logger::stopWriter()
+{
+   pthread_mutex_lock(&m_WakeMutex);
+   m_WriterRunning.store(false);
+   pthread_cond_broadcast(&m_WakeCond);
+   pthread_cond_broadcast(&m_SpaceCond);
+   pthread_mutex_unlock(&m_WakeMutex);
+
+   pthread_join(m_Writer, NULL);
+}
+
+///
+/// Waits for the writer thread to write out everything queued before this call.
+/// In synchronous mode it only flushes the stream buffers.
+///
+void Logger::flush()
+{
+   flushSinks();
+   if(m_TraceEnabled.load(std::memory_order_relaxed))
+      m_Trace.flush();
+
+   if(!m_WriterRunning.load(std::memory_order_acquire))
+   {
+      lock();
+      flushFile(monotonicMs());
+      unlock();
+      if(m_MappedFile.isOpen())
+         m_MappedFile.sync(false);
+      return;
+   }
+
+   pthread_mutex_lock(&m_WakeMutex);
+   uint64_t ticket = m_FlushRequest.fetch_add(1) + 1;
+   pthread_cond_broadcast(&m_WakeCond);
+   while(m_FlushAck.load() < ticket && m_WriterRunning.load())
+   {
+      pthread_cond_wait(&m_WakeCond, &m_WakeMutex);
+   }
+   pthread_mutex_unlock(&m_WakeMutex);
+
+   if(m_MappedFile.isOpen())
+      m_MappedFile.sync(false);
+}
+
+///
+/// Interface to tune how often the log file is flushed
+///
+void Logger::setFlushPolicy(size_t bytes, unsigned intervalMs, LOG_LEVEL immediateLevel)
+{
+   m_FlushBytes.store(bytes, std::memory_order_relaxed);
+   m_FlushIntervalMs.store(intervalMs, std::memory_order_relaxed);
+   m_FlushLevel.store(immediateLevel, std::memory_order_relaxed);
+}
+
+///
+/// Interface to choose seconds, milliseconds or microseconds in record timestamps
+///
+void Logger::setTimestampPrecision(TimestampPrecision precision)
+{
+   m_Timestamp.setPrecision(precision);
+}
+
+uint64_t Logger::getDroppedCount() const
+{
+   return m_Dropped.load(std::memory_order_relaxed);
+}
+
+///
+/// Deferred and binary encodings move argument formatting off the caller's thread.
+/// The binary log file is opened (and its header written) before the encoding is switched.
+///
+void Logger::setLogEncoding(LogEncoding encoding)
+{
+   if(encoding == ENCODE_BINARY && !m_BinaryFile.is_open())
+   {
+      const string binaryFileName = m_FileName + ".bin";
+      m_BinaryFile.open(binaryFileName.c_str(), ios::out|ios::app|ios::binary);
+      if(!m_BinaryFile.is_open())
+      {
+         printf("Logger::setLogEncoding() -- Unable to open %s, keeping text encoding!!\n", binaryFileName.c_str());
+         return;
+      }
+
+      // Every process run starts a new section with its own call site keys
+      m_BinaryFile.write(BINARY_LOG_MAGIC, BINARY_LOG_MAGIC_SIZE);
+   }
+
+   m_Encoding.store(encoding, std::memory_order_release);
+}
+
+///
+/// Interface to switch between text, JSON lines and logfmt records at runtime
+///
+void Logger::setLogFormat(LogFormat logFormat)
+{
+   m_Format.store(logFormat, std::memory_order_relaxed);
+}
+
+///
+/// Hands a record over to the writer thread, applying the overflow policy when the queue is full.
+/// The record is copied straight into its queue slot, whose string keeps its capacity between laps.
+///
+void Logger::enqueue(LogType type, LOG_LEVEL level, std::string_view timestamp, std::string_view text, bool binary)
+{
+   auto fill = [&](LogRecord& record)
+   {
+      record.type   = type;
+      record.level  = level;
+      record.binary = binary;
+      record.text.assign(timestamp.data(), timestamp.size());
+      if(!timestamp.empty())
+         record.text.append("  ", 2);
+      record.text.append(text.data(), text.size());
+   };
+
+   ThreadStats* stats  = threadStats();
+   bool         waited = false;
+   while(!m_Queue->tryPush(fill))
+   {
+      if(m_OverflowPolicy == OVERFLOW_DROP_NEWEST)
+      {
+         m_Dropped.fetch_add(1, std::memory_order_relaxed);
+         if(stats)
+            stats->droppedNewest.add(1);
+         return;
+      }
+      else if(m_OverflowPolicy == OVERFLOW_DROP_OLDEST)
+      {
+         if(m_Queue->tryPop([](LogRecord&) { }))
+         {
+            m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            if(stats)
+               stats->droppedOldest.add(1);
+         }
+      }
+      else
+      {
+         if(stats && !waited)
+            stats->blocked.add(1);
+         waited = true;
+         waitForSpace();
+      }
+   }
+
+   if(stats)
+      noteHighWater(m_QueueHighWater, m_Queue->size());
+
+   // Pairs with the fence in waitForWork(): either the writer sees this record or this
+   // thread sees the writer idle. The other backoffs skip the fence.
+   if(LOG_UNLIKELY(m_Backoff.load(std::memory_order_relaxed) == BACKOFF_BLOCK))
+   {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(m_WriterIdle.load(std::memory_order_relaxed))
+         wakeWriter();
+   }
+}
+
+void Logger::writeRecord(const LogRecord& record)
+{
+   if(!record.binary && record.type != MMAP_FILE_LOG)
+      countBytes(record.text.size() + 1);
+
+   if(record.type == FILE_LOG)
+   {
+      m_PendingBytes += record.text.size() + 1;
+      if(record.level <= m_FlushLevel.load(std::memory_order_relaxed))
+         m_UrgentPending = true;
+      if(!record.binary || m_Encoding.load(std::memory_order_relaxed) != ENCODE_BINARY)
+         m_FileBytes += record.text.size() + 1;
+   }
+
+   if(record.binary)
+   {
+      if(m_Encoding.load(std::memory_order_relaxed) == ENCODE_BINARY)
+         writeBinaryRecord(record);
+      else
+         writeDeferredRecord(record);
+   }
+   else if(record.type == FILE_LOG)
+   {
+      m_File.write(record.text.data(), record.text.size()) << '\n';
+   }
+   else if(record.type == CONSOLE)
+   {
+      m_Console.buffer(record.level, record.text);
+   }
+   else if(record.type == MMAP_FILE_LOG)
+   {
+      logIntoMappedFile(std::string_view(), record.text);
+   }
+}
+
+///
+/// Renders a deferred entry into the usual text line on the writer thread
+///
+void Logger::writeDeferredRecord(const LogRecord& record)
+{
+   const char* pos = record.text.data();
+   const char* end = pos + record.text.size();
+
+   uint64_t key, timestamp;
+   if(!BinaryDecoder::getInt(pos, end, key) || !BinaryDecoder::getInt(pos, end, timestamp))
+      return;
+
+   // Deferred entries never leave the process, so the key is still a valid LogSite pointer
+   const LogSite* site = (const LogSite*)(uintptr_t)key;
+
+   char   stamp[TIMESTAMP_MAX_LENGTH];
+   size_t length = m_Timestamp.render(timestamp, stamp);
+
+   format fmt(std::string_view(stamp, length));
+   fmt.append("  ", 2);
+   fmt.append(site->prefixView());
+   BinaryDecoder::renderArgs(pos, end, fmt);
+
+   std::string_view line = fmt.view();
+   if(record.type != MMAP_FILE_LOG)
+      countBytes(line.size() + 1);
+   if(record.type == FILE_LOG)
+   {
+      m_File.write(line.data(), line.size()) << '\n';
+   }
+   else if(record.type == CONSOLE)
+   {
+      m_Console.buffer(record.level, line);
+   }
+   else if(record.type == MMAP_FILE_LOG)
+   {
+      logIntoMappedFile(std::string_view(), line);
+   }
+}
+
+///
+/// Appends an entry to the binary log file, describing its call site first if this
+/// file has not seen it yet
+///
+void Logger::writeBinaryRecord(const LogRecord& record)
+{
+   uint64_t key;
+   const char* pos = record.text.data();
+   if(!BinaryDecoder::getInt(pos, pos + record.text.size(), key))
+      return;
+
+   if(m_KnownSites.insert((const void*)(uintptr_t)key).second)
+   {
+      const LogSite* site = (const LogSite*)(uintptr_t)key;
+
+      format desc;
+      desc.append((char)BINARY_SITE);
+      BinaryEncoder::putInt(desc, key);
+      BinaryEncoder::putInt(desc, (int32_t)site->level);
+      BinaryEncoder::putInt(desc, (int32_t)site->line);
+      BinaryEncoder::putString(desc, ARG_TEXT, site->prefixView());
+      BinaryEncoder::putString(desc, ARG_TEXT, site->file);
+
+      uint32_t length = (uint32_t)desc.size();
+      m_BinaryFile.write((const char*)&length, sizeof(length));
+      m_BinaryFile.write(desc.view().data(), length);
+   }
+
+   uint32_t length = (uint32_t)record.text.size() + 1;
+   const char kind = BINARY_ENTRY;
+   m_BinaryFile.write((const char*)&length, sizeof(length));
+   m_BinaryFile.write(&kind, 1);
+   m_BinaryFile.write(record.text.data(), record.text.size());
+   countBytes(sizeof(length) + length);
+}
+
+///
+/// Appends one line to the calling thread's batch. Only the thread itself and, now and then,
+/// the writer thread take the buffer's lock.
+///
+void Logger::appendToBatch(LogType type, LOG_LEVEL level, std::string_view timestamp, std::string_view text)
+{
+   ThreadBuffer* buffer = threadBuffer();
+
+   pthread_mutex_lock(&buffer->lock);
+   if(buffer->type != type && !buffer->data.empty())
+      handOver(buffer);
+   buffer->type = type;
+
+   std::string& data = buffer->data;
+   const std::string_view color = (type == CONSOLE) ? m_Console.prefix(level) : std::string_view();
+   data.append(color.data(), color.size());
+   if(m_BatchSequenced)
+   {
+      char seq[24];
+      seq[0] = '#';
+      char* end = std::to_chars(seq + 1, seq + sizeof(seq) - 1, m_Sequence.fetch_add(1, std::memory_order_relaxed)).ptr;
+      *end++ = ' ';
+      data.append(seq, end - seq);
+   }
+   data.append(timestamp.data(), timestamp.size());
+   if(!timestamp.empty())
+      data.append("  ", 2);
+   data.append(text.data(), text.size());
+   const std::string_view reset = ConsoleOutput::suffix(color);
+   data.append(reset.data(), reset.size());
+   data.push_back('\n');
+
+   // Urgent lines are handed over right away so the writer picks them up on its next wake up
+   const bool full   = data.size() >= m_BatchSize;
+   const bool urgent = level <= m_FlushLevel.load(std::memory_order_relaxed);
+   if(full || urgent)
+      handOver(buffer);
+   pthread_mutex_unlock(&buffer->lock);
+
+   if(urgent)
+   {
+      m_BatchUrgent.store(true, std::memory_order_relaxed);
+      pthread_cond_signal(&m_WakeCond);
+   }
+
+   if(full)
+   {
+      pthread_cond_signal(&m_WakeCond);
+
+      // Back pressure: wait while the writer is far behind
+      for(bool waited = false; ; waited = true)
+      {
+         pthread_mutex_lock(&m_BatchMutex);
+         const size_t pending = m_FullBatches.size();
+         pthread_mutex_unlock(&m_BatchMutex);
+         if(pending < MAX_PENDING_BATCHES || !m_WriterRunning.load())
+            break;
+         ThreadStats* stats = threadStats();
+         if(stats && !waited)
+            stats->blocked.add(1);
+         sched_yield();
+      }
+   }
 }
 
+///
+/// Returns the calling thread's batch buffer, registering it on first use
+///
+ThreadBuffer* Logger::threadBuffer()
+{
+   ThreadBuffer*& owned = t_BufferOwner.buffer[m_Index];
+   if(owned == NULL)
+   {
+      ThreadBuffer* buffer = new ThreadBuffer();
+      pthread_mutex_lock(&m_BatchMutex);
+      m_ThreadBuffers.push_back(buffer);
+      pthread_mutex_unlock(&m_BatchMutex);
+      owned = buffer;
+   }
+   return owned;
+}
+
+///
+/// Moves the buffered lines into the list of batches waiting for the writer.
+/// Called with the buffer's lock held. The buffer gets a recycled string back, so
+/// its capacity survives the hand over.
+///
+void Logger::handOver(ThreadBuffer* buffer)
+{
+   pthread_mutex_lock(&m_BatchMutex);
+   LogBatch* batch;
+   if(m_SpareBatches.empty())
+   {
+      batch = new LogBatch();
+      batch->data.reserve(m_BatchSize + LOG_FORMAT_INLINE_SIZE);
+   }
+   else
+   {
+      batch = m_SpareBatches.back();
+      m_SpareBatches.pop_back();
+   }
+   batch->type = buffer->type;
+   batch->data.swap(buffer->data);
+   m_FullBatches.push_back(batch);
+   pthread_mutex_unlock(&m_BatchMutex);
+}
+
+///
+/// Collects every thread's partial batch behind the full ones, then writes them all.
+/// The list keeps hand over order, so each thread's lines stay in order.
+///
+void Logger::drainBatches()
+{
+   std::vector<ThreadBuffer*> buffers;
+   pthread_mutex_lock(&m_BatchMutex);
+   buffers = m_ThreadBuffers;
+   pthread_mutex_unlock(&m_BatchMutex);
+
+   for(size_t i = 0; i < buffers.size(); ++i)
+   {
+      ThreadBuffer* buffer = buffers[i];
+
+      pthread_mutex_lock(&buffer->lock);
+      if(!buffer->data.empty())
+         handOver(buffer);
+      const bool retired = buffer->retired;
+      pthread_mutex_unlock(&buffer->lock);
+
+      if(retired)
+      {
+         pthread_mutex_lock(&m_BatchMutex);
+         for(size_t j = 0; j < m_ThreadBuffers.size(); ++j)
+         {
+            if(m_ThreadBuffers[j] == buffer)
+            {
+               m_ThreadBuffers[j] = m_ThreadBuffers.back();
+               m_ThreadBuffers.pop_back();
+               break;
+            }
+         }
+         pthread_mutex_unlock(&m_BatchMutex);
+         delete buffer;
+      }
+   }
+
+   std::vector<LogBatch*> batches;
+   pthread_mutex_lock(&m_BatchMutex);
+   batches.swap(m_FullBatches);
+   pthread_mutex_unlock(&m_BatchMutex);
+
+   if(batches.empty())
+      return;
+
+   writeBatches(batches);
+
+   pthread_mutex_lock(&m_BatchMutex);
+   for(size_t i = 0; i < batches.size(); ++i)
+   {
+      batches[i]->data.clear();
+      m_SpareBatches.push_back(batches[i]);
+   }
+   pthread_mutex_unlock(&m_BatchMutex);
+}
+
+///
+/// One writev() per run of batches going to the same descriptor
+///
+void Logger::writeBatches(std::vector<LogBatch*>& batches)
+{
+   parkIfCrashing();
+   struct iovec iov[IOV_MAX];
+   int          count = 0;
+   int          fd    = -1;
+   ThreadStats* stats = threadStats();
+
+   auto writeRun = [&]()
+   {
+      LatencyTimer timer(stats ? &stats->writeLatency : NULL);
+      if(stats)
+         stats->flushes.add(1);
+      writeFully(fd, iov, count);
+   };
+
+   for(size_t i = 0; i < batches.size(); ++i)
+   {
+      countBytes(batches[i]->data.size());
+      if(batches[i]->type == MMAP_FILE_LOG)
+      {
+         const std::string& data = batches[i]->data;
+         m_MappedFile.write(data.data(), data.size());
+         continue;
+      }
+
+      const int target = (batches[i]->type == CONSOLE) ? STDOUT_FILENO : m_BatchFd;
+      if(target == m_BatchFd)
+         m_FileBytes += batches[i]->data.size();
+      if(target == m_BatchFd && m_BatchWriter.isOpen())
+      {
+         // Copied into the file writer's buffers. Only its O_DIRECT tail and fdatasync wait
+         // for the flush policy, everything else is submitted at the end of the pass.
+         const std::string& data = batches[i]->data;
+         m_BatchWriter.append(data.data(), data.size());
+         if(m_FileSync || m_BatchWriter.direct())
+            m_PendingBytes += data.size();
+         continue;
+      }
+      if(count == IOV_MAX || (count > 0 && target != fd))
+      {
+         writeRun();
+         count = 0;
+      }
+
+      fd = target;
+      iov[count].iov_base = (void*)batches[i]->data.data();
+      iov[count].iov_len  = batches[i]->data.size();
+      ++count;
+   }
+
+   if(count > 0)
+      writeRun();
+
+   if(m_BatchWriter.isOpen())
+   {
+      LatencyTimer timer(stats ? &stats->writeLatency : NULL);
+      m_BatchWriter.submit();
+      if(m_BatchUrgent.exchange(false, std::memory_order_relaxed))
+         m_UrgentPending = true;
+   }
+}
+
+///
+/// Writes out everything currently queued, then flushes the streams and acknowledges
+/// pending flush() calls. Runs on the writer thread only.
+///
+void Logger::drainQueue()
+{
+   uint64_t request = m_FlushRequest.load(std::memory_order_acquire);
+   bool     wrote   = false;
+
+   if(m_BatchFd >= 0)
+      drainBatches();
+
+   // The backlog the writer wakes up to, stats() must not touch a queue that may go away
+   if(m_Queue && m_StatsEnabled.load(std::memory_order_relaxed))
+      m_QueueDepth.store(m_Queue->size(), std::memory_order_relaxed);
+
+   // At most one queue's worth per pass: that covers everything queued before the flush
+   // request, and the flush and rotation policies below still run under a steady load
+   auto write = [this](LogRecord& record) { writeRecord(record); };
+   size_t budget = m_Queue ? m_Queue->capacity() : 0;
+   while(budget > 0)
+   {
+      // Not while a record is popped: the crash handler takes the queued ones itself
+      parkIfCrashing();
+      if(m_Queue->tryPop(write))
+      {
+         wrote = true;
+         --budget;
+
+         // Pairs with the fence in waitForSpace(): a producer going to sleep on the full
+         // queue either sees this slot free or is counted here
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if(LOG_UNLIKELY(m_SpaceWaiters.load(std::memory_order_relaxed) != 0))
+         {
+            pthread_mutex_lock(&m_WakeMutex);
+            pthread_cond_broadcast(&m_SpaceCond);
+            pthread_mutex_unlock(&m_WakeMutex);
+         }
+      }
+      else if(m_Queue->empty())
+      {
+         break;
+      }
+      else
+      {
+         // A producer claimed a slot but has not published it yet
+         sched_yield();
+      }
+   }
+
+   // The console is written at the end of every pass, the file follows the flush policy
+   const bool flushRequested = (request != m_FlushAck.load(std::memory_order_relaxed));
+   const uint64_t now = monotonicMs();
+   if(flushRequested || fileFlushDue(m_UrgentPending, now))
+      flushFile(now);
+   if(wrote || flushRequested)
+   {
+      ThreadStats* stats = threadStats();
+      LatencyTimer writeTimer(stats ? &stats->writeLatency : NULL);
+      m_Console.flush();
+   }
+
+   lock();
+   rotateIfDue();
+   unlock();
+
+   if(request != m_FlushAck.load(std::memory_order_relaxed))
+   {
+      pthread_mutex_lock(&m_WakeMutex);
+      m_FlushAck.store(request);
+      pthread_cond_broadcast(&m_WakeCond);
+      pthread_mutex_unlock(&m_WakeMutex);
+   }
+}
+
+///
+/// Body of the background writer thread
+///
+void* Logger::writerThread(void* arg)
+{
+   Logger* logger = static_cast<Logger*>(arg);
+
+   while(logger->m_WriterRunning.load())
+   {
+      logger->drainQueue();
+      logger->waitForWork();
+   }
+
+   // Final drain on shutdown
+   logger->drainQueue();
+   return NULL;
+}
+
+///
+/// Keeps a record in the calling thread's ring when the flight recorder wants its level, true
+/// when it did. A FATAL record dumps the rings first, so the context precedes it.
+///
+bool Logger::toFlightRecorder(LOG_LEVEL level, std::string_view data, bool stamped)
+{
+   if(level == LOG_LEVEL_FATAL)
+   {
+      dumpFlightRecorder();
+      return false;
+   }
+
+   if(level < m_FlightLevel.load(std::memory_order_relaxed) || level > LOG_LEVEL_TRACE)
+      return false;
+
+   FlightRing*& ring = t_FlightRing.ring[m_Index];
+   if(ring == NULL)
+   {
+      // Every slot taken by a live thread: this one logs normally
+      ring = m_FlightRecorder.acquire();
+      if(ring == NULL)
+         return false;
+   }
+
+   char   stamp[TIMESTAMP_MAX_LENGTH];
+   size_t length = stamped ? m_Timestamp.now(stamp) : 0;
+   ring->appendLine(std::string_view(stamp, length), data);
+   return true;
+}
+
+///
+/// Opens the dump descriptor up front, then starts recording
+///
+void Logger::enableFlightRecorder(LOG_LEVEL level, size_t ringSize, bool onCrash)
+{
+   if(!openDumpFile())
+   {
+      printf("Logger::enableFlightRecorder() -- Unable to open the dump file, flight recorder stays off!!\n");
+      return;
+   }
+
+   m_FlightRecorder.setRingSize(ringSize);
+   m_FlightLevel.store(level, std::memory_order_relaxed);
+   if(onCrash)
+      installCrashHandler();
+
+   m_FlightEnabled.store(true, std::memory_order_release);
+}
+
+///
+/// Records are written normally again. The rings keep their content for dumpFlightRecorder().
+///
+void Logger::disableFlightRecorder()
+{
+   m_FlightEnabled.store(false, std::memory_order_release);
+}
+
+///
+/// Writes the rings after everything logged so far
+///
+void Logger::dumpFlightRecorder()
+{
+   if(m_DumpFd < 0)
+      return;
+
+   flush();
+   m_FlightRecorder.dump(m_DumpFd);
+}
+
+///
+/// Descriptor for the flight recorder dumps and the crash handler, appending to the log file
+///
+bool Logger::openDumpFile()
+{
+   if(m_DumpFd >= 0)
+      return true;
+
+   // Appending would land behind the pre-allocated extent of the memory-mapped sink
+   const string path = (logType() == MMAP_FILE_LOG) ? m_FileName + ".dump" : m_FileName;
+   m_DumpFd = open(path.c_str(), O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0644);
+   return m_DumpFd >= 0;
+}
+
+///
+/// Installs crashSignal() for the fatal signals, on an alternate stack of the calling thread
+///
+void Logger::installCrashHandler()
+{
+   if(!openDumpFile())
+   {
+      printf("Logger::installCrashHandler() -- Unable to open the dump file, no crash handler!!\n");
+      return;
+   }
+
+   // backtrace() loads libgcc on its first call, which must not happen in the handler
+   void* frames[4];
+   backtrace(frames, 4);
+
+   static char* alternateStack = NULL;
+   if(alternateStack == NULL)
+   {
+      stack_t stack;
+      memset(&stack, 0, sizeof(stack));
+      alternateStack = new char[CRASH_STACK_SIZE];
+      stack.ss_sp    = alternateStack;
+      stack.ss_size  = CRASH_STACK_SIZE;
+      sigaltstack(&stack, NULL);
+   }
+
+   // The application's own actions are kept for crashSignal(), an ignored signal stays
+   // ignored. Installing again (another logger) keeps the actions saved the first time.
+   for(size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i)
+   {
+      struct sigaction current;
+      if(sigaction(g_CrashSignals[i], NULL, &current) != 0)
+         continue;
+      const bool ours = !(current.sa_flags & SA_SIGINFO) && current.sa_handler == &Logger::crashSignal;
+      if(ours || (!(current.sa_flags & SA_SIGINFO) && current.sa_handler == SIG_IGN))
+         continue;
+
+      g_PreviousActions[i] = current;
+      installCrashAction(g_CrashSignals[i]);
+   }
+}
+
+///
+/// crashSignal() for one signal. SA_RESETHAND puts the default action back as the handler
+/// starts, SA_NODEFER lets its raise() deliver the signal right away.
+///
+void Logger::installCrashAction(int sig)
+{
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = &Logger::crashSignal;
+   sigemptyset(&action.sa_mask);
+   action.sa_flags   = SA_RESETHAND|SA_NODEFER|SA_ONSTACK;
+   sigaction(sig, &action, NULL);
+}
+
+///
+/// Puts back the action the application had for 'sig' before installCrashHandler()
+///
+static void restorePreviousAction(int sig)
+{
+   for(size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i)
+   {
+      if(g_CrashSignals[i] == sig)
+         sigaction(sig, &g_PreviousActions[i], NULL);
+   }
+}
+
+///
+/// Fatal signal: write out what is still in memory, then pass the signal on to the action the
+/// application had installed before, the default one (the process dies) unless it had a
+/// handler of its own. Should that handler return, e.g. after it only flagged a graceful
+/// shutdown on SIGTERM, logging resumes and this handler is installed again.
+///
+void Logger::crashSignal(int sig)
+{
+   // SA_NODEFER lets a signal reach the thread already in here: a crash while writing out, or
+   // a supervisor's SIGTERM. Waiting for ourselves would hang, so it goes on to the previous
+   // action at once. A second crashing thread waits for the first one to finish the job.
+   static std::atomic<long> handlingThread(0);
+   const long self = syscall(SYS_gettid);
+   if(handlingThread.load() == self)
+   {
+      restorePreviousAction(sig);
+      raise(sig);
+      installCrashAction(sig);
+      return;
+   }
+   long idle = 0;
+   while(!handlingThread.compare_exchange_strong(idle, self))
+   {
+      idle = 0;
+      sleep(1);
+   }
+
+   bool locked[MAX_LOGGERS];
+   for(size_t i = 0; i < MAX_LOGGERS; ++i)
+   {
+      Logger* logger = g_Loggers[i].load(std::memory_order_acquire);
+      locked[i] = (logger != NULL && logger->m_DumpFd >= 0) ? logger->writePending(sig) : false;
+   }
+
+   restorePreviousAction(sig);
+   raise(sig);
+
+   // Only reached when the application's handler returned
+   for(size_t i = 0; i < MAX_LOGGERS; ++i)
+   {
+      Logger* logger = g_Loggers[i].load(std::memory_order_acquire);
+      if(logger != NULL && logger->m_DumpFd >= 0)
+         logger->resumeAfterSignal(locked[i]);
+   }
+   installCrashAction(sig);
+   handlingThread.store(0);
+}
+
+///
+/// Idle step of the writer thread between two drain passes, as chosen by setWriterBackoff()
+///
+void Logger::waitForWork()
+{
+   const WriterBackoff backoff = m_Backoff.load(std::memory_order_relaxed);
+   if(backoff == BACKOFF_SPIN)
+   {
+      for(int i = 0; i < 64; ++i)
+         cpuRelax();
+      return;
+   }
+   if(backoff == BACKOFF_SLEEP)
+   {
+      const unsigned us = m_BackoffSleepUs.load(std::memory_order_relaxed);
+      struct timespec delay = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+      nanosleep(&delay, NULL);
+      return;
+   }
+
+   pthread_mutex_lock(&m_WakeMutex);
+   if(m_WriterRunning.load() && m_FlushRequest.load() == m_FlushAck.load())
+   {
+      if(backoff == BACKOFF_BLOCK)
+      {
+         // Announce the wait before the last look at the queue, see enqueue()
+         m_WriterIdle.store(true, std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if(m_Queue == NULL || m_Queue->empty())
+         {
+            const struct timespec deadline = deadlineIn(WRITER_IDLE_TIMEOUT_MS * 1000);
+            pthread_cond_timedwait(&m_WakeCond, &m_WakeMutex, &deadline);
+         }
+         m_WriterIdle.store(false, std::memory_order_relaxed);
+      }
+      else if(m_Queue == NULL || m_Queue->empty())
+      {
+         // Producers never signal, so poll the queue at least once per millisecond
+         const struct timespec deadline = deadlineIn(1000);
+         pthread_cond_timedwait(&m_WakeCond, &m_WakeMutex, &deadline);
+      }
+   }
+   pthread_mutex_unlock(&m_WakeMutex);
+}
+
+///
+/// A producer found the BACKOFF_BLOCK writer idle. Broadcast, flush() waits on the same
+/// condition.
+///
+void Logger::wakeWriter()
+{
+   pthread_mutex_lock(&m_WakeMutex);
+   pthread_cond_broadcast(&m_WakeCond);
+   pthread_mutex_unlock(&m_WakeMutex);
+}
+
+///
+/// OVERFLOW_BLOCK producer on a full queue: sleeps until the writer pops a record. The
+/// timeout only bounds a missed wakeup, e.g. while the writer is stopping.
+///
+void Logger::waitForSpace()
+{
+   pthread_mutex_lock(&m_WakeMutex);
+   m_SpaceWaiters.fetch_add(1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if(m_WriterRunning.load() && m_Queue->size() >= m_Queue->capacity())
+   {
+      const struct timespec deadline = deadlineIn(WRITER_IDLE_TIMEOUT_MS * 1000);
+      pthread_cond_timedwait(&m_SpaceCond, &m_WakeMutex, &deadline);
+   }
+   m_SpaceWaiters.fetch_sub(1, std::memory_order_relaxed);
+   pthread_mutex_unlock(&m_WakeMutex);
+}
+
+void Logger::setWriterBackoff(WriterBackoff backoff, unsigned sleepUs)
+{
+   m_BackoffSleepUs.store(sleepUs, std::memory_order_relaxed);
+   m_Backoff.store(backoff, std::memory_order_relaxed);
+   wakeWriter();
+}
+
+///
+/// Interface to pin the background threads
+///
+bool Logger::setBackendAffinity(const std::vector<int>& cpus)
+{
+   for(size_t i = 0; i < cpus.size(); ++i)
+   {
+      if(cpus[i] < 0 || cpus[i] >= CPU_SETSIZE)
+      {
+         printf("Logger::setBackendAffinity() -- Invalid CPU %d, nothing pinned!!\n", cpus[i]);
+         return false;
+      }
+   }
+
+   pthread_mutex_lock(&m_AffinityMutex);
+   m_BackendCpus = cpus;
+   pthread_mutex_unlock(&m_AffinityMutex);
+
+   // Threads started from now on pin themselves in pinBackend(), move the running ones
+   bool pinned = true;
+   if(m_WriterRunning.load())
+      pinned &= CpuAffinity::pin(m_Writer, cpus);
+   if(m_ConfigRunning.load())
+      pinned &= CpuAffinity::pin(m_ConfigThread, cpus);
+   if(m_StatsRunning.load())
+      pinned &= CpuAffinity::pin(m_StatsThread, cpus);
+
+   pthread_mutex_lock(&m_SinkMutex);
+   for(size_t i = 0; i < MAX_LOG_SINKS; ++i)
+   {
+      SinkQueue* sink = m_Sinks[i].load();
+      if(sink)
+         pinned &= CpuAffinity::pin(sink->thread, cpus);
+   }
+   pthread_mutex_unlock(&m_SinkMutex);
+
+   if(!pinned)
+      printf("Logger::setBackendAffinity() -- Not every thread could be pinned!!\n");
+   return pinned;
+}
+
+bool Logger::setBackendNode(int node)
+{
+   const std::vector<int> cpus = CpuAffinity::nodeCpus(node);
+   if(cpus.empty())
+   {
+      printf("Logger::setBackendNode() -- No CPUs found for node %d!!\n", node);
+      return false;
+   }
+   return setBackendAffinity(cpus);
+}
+
+void Logger::pinBackend(pthread_t thread)
+{
+   pthread_mutex_lock(&m_AffinityMutex);
+   if(!m_BackendCpus.empty() && !CpuAffinity::pin(thread, m_BackendCpus))
+      printf("Logger::pinBackend() -- Unable to pin a background thread!!\n");
+   pthread_mutex_unlock(&m_AffinityMutex);
+}
+
+///
+/// Stops the writer thread (and synchronous writers) for good while the crash handler
+/// reads the buffers they write to
+///
+void Logger::parkIfCrashing()
+{
+   if(LOG_LIKELY(!m_Crashing.load(std::memory_order_relaxed)))
+      return;
+
+   // Until the process dies of the signal, or the application's handler returned
+   m_Parked.fetch_add(1);
+   while(m_Crashing.load())
+   {
+      struct timespec delay = { 0, 1000000 };
+      nanosleep(&delay, NULL);
+   }
+   m_Parked.fetch_sub(1);
+}
+
+///
+/// The application's signal handler returned: releases the writers writePending() stopped.
+/// What the dump wrote from the stream and batch buffers is written again by them.
+///
+void Logger::resumeAfterSignal(bool locked)
+{
+   m_Crashing.store(false);
+   if(locked)
+      pthread_mutex_unlock(&m_Mutex);
+}
+
+///
+/// Gives access to the put area of the m_File buffer. Naming pbase/pptr through a derived
+/// class is what makes the protected members reachable, the object is never cast.
+///
+struct PutArea : std::filebuf
+{
+   static std::string_view pending(std::filebuf* buffer)
+   {
+      char* (std::filebuf::*begin)() const = &PutArea::pbase;
+      char* (std::filebuf::*end)() const   = &PutArea::pptr;
+      char* from = (buffer->*begin)();
+      char* to   = (buffer->*end)();
+      return (from && to > from) ? std::string_view(from, to - from) : std::string_view();
+   }
+};
+
+///
+/// Body of the crash handler, write(2) only. Oldest first: the stream buffer, then what the
+/// writer thread has not taken yet, the flight recorder rings and last the backtrace.
+///
+bool Logger::writePending(int sig)
+{
+   const int fd = m_DumpFd;
+   struct iovec iov[1];
+
+   // Keep the other writers out: synchronous ones wait for m_Mutex, the writer thread parks
+   // at its next record. Give it up to 100 ms to get there. When m_Mutex is taken, by another
+   // thread or by the one that crashed, the stream buffer may be halfway through an update
+   // and is left out.
+   const bool locked = (pthread_mutex_trylock(&m_Mutex) == 0);
+   m_Crashing.store(true);
+   if(m_WriterRunning.load())
+   {
+      for(int i = 0; i < 100 && m_Parked.load() == 0; ++i)
+      {
+         struct timespec delay = { 0, 1000000 };
+         nanosleep(&delay, NULL);
+      }
+   }
+
+   if(locked)
+   {
+      const std::string_view stream = PutArea::pending(m_File.rdbuf());
+      if(!stream.empty())
+      {
+         iov[0].iov_base = (void*)stream.data();
+         iov[0].iov_len  = stream.size();
+         writeFully(fd, iov, 1);
+      }
+   }
+   else
+   {
+      static const char skipped[] = "----- log file buffer in use, not written -----\n";
+      iov[0].iov_base = (void*)skipped;
+      iov[0].iov_len  = sizeof(skipped) - 1;
+      writeFully(fd, iov, 1);
+   }
+
+   const std::string_view console = m_Console.pending();
+   if(!console.empty())
+   {
+      iov[0].iov_base = (void*)console.data();
+      iov[0].iov_len  = console.size();
+      writeFully(STDOUT_FILENO, iov, 1);
+   }
+
+   if(m_Queue != NULL)
+   {
+      auto write = [fd](LogRecord& record)
+      {
+         if(record.binary)
+            return;
+         struct iovec line[2];
+         line[0].iov_base = (void*)record.text.data();
+         line[0].iov_len  = record.text.size();
+         line[1].iov_base = (void*)"\n";
+         line[1].iov_len  = 1;
+         writeFully(record.type == CONSOLE ? STDOUT_FILENO : fd, line, 2);
+      };
+      while(m_Queue->tryPop(write))
+      {
+      }
+   }
+
+   // The batch lists are behind mutexes, skip whatever is locked right now
+   if(pthread_mutex_trylock(&m_BatchMutex) == 0)
+   {
+      for(size_t i = 0; i < m_FullBatches.size(); ++i)
+      {
+         iov[0].iov_base = (void*)m_FullBatches[i]->data.data();
+         iov[0].iov_len  = m_FullBatches[i]->data.size();
+         writeFully(m_FullBatches[i]->type == CONSOLE ? STDOUT_FILENO : fd, iov, 1);
+      }
+      for(size_t i = 0; i < m_ThreadBuffers.size(); ++i)
+      {
+         ThreadBuffer* buffer = m_ThreadBuffers[i];
+         if(pthread_mutex_trylock(&buffer->lock) != 0)
+            continue;
+         iov[0].iov_base = (void*)buffer->data.data();
+         iov[0].iov_len  = buffer->data.size();
+         writeFully(buffer->type == CONSOLE ? STDOUT_FILENO : fd, iov, 1);
+         pthread_mutex_unlock(&buffer->lock);
+      }
+      pthread_mutex_unlock(&m_BatchMutex);
+   }
+
+   // Copied into the file writer and not yet submitted; what is in flight the kernel finishes
+   const std::string_view unwritten = m_BatchWriter.pending();
+   if(!unwritten.empty())
+   {
+      iov[0].iov_base = (void*)unwritten.data();
+      iov[0].iov_len  = unwritten.size();
+      writeFully(fd, iov, 1);
+   }
+
+   m_FlightRecorder.dump(fd);
+
+   // "----- signal <n>, backtrace -----"
+   char   banner[64] = "----- signal ";
+   size_t length     = strlen(banner);
+   char   digits[12];
+   size_t count      = 0;
+   unsigned value    = (unsigned)sig;
+   do
+   {
+      digits[count++] = (char)('0' + value % 10);
+      value /= 10;
+   } while(value != 0);
+   while(count > 0)
+      banner[length++] = digits[--count];
+   memcpy(banner + length, ", backtrace -----\n", 18);
+   length += 18;
+   iov[0].iov_base = banner;
+   iov[0].iov_len  = length;
+   writeFully(fd, iov, 1);
+
+   void* frames[CRASH_BACKTRACE_DEPTH];
+   const int depth = backtrace(frames, CRASH_BACKTRACE_DEPTH);
+   backtrace_symbols_fd(frames, depth, fd);
+   return locked;
+}
+
+///
+/// Registers a sink and starts its thread. Safe while other threads log.
+///
+bool Logger::addSink(LogSink* sink, LOG_LEVEL level, size_t capacity, OverflowPolicy policy)
+{
+   if(sink == NULL)
+      return false;
+
+   pthread_mutex_lock(&m_SinkMutex);
+   size_t slot = MAX_LOG_SINKS;
+   for(size_t i = 0; i < MAX_LOG_SINKS; ++i)
+   {
+      SinkQueue* used = m_Sinks[i].load(std::memory_order_relaxed);
+      if(used && used->sink == sink)
+      {
+         pthread_mutex_unlock(&m_SinkMutex);
+         return false;
+      }
+      if(!used && slot == MAX_LOG_SINKS)
+         slot = i;
+   }
+   if(slot == MAX_LOG_SINKS)
+   {
+      pthread_mutex_unlock(&m_SinkMutex);
+      printf("Logger::addSink() -- All %d sink slots are in use!!\n", MAX_LOG_SINKS);
+      return false;
+   }
+
+   SinkQueue* queue = new SinkQueue(sink, level, capacity, policy);
+   queue->running.store(true);
+   if(pthread_create(&queue->thread, NULL, &Logger::sinkThread, queue) != 0)
+   {
+      pthread_mutex_unlock(&m_SinkMutex);
+      printf("Logger::addSink() -- Sink thread not created!!\n");
+      delete queue;
+      return false;
+   }
+   pinBackend(queue->thread);
+
+   m_Sinks[slot].store(queue, std::memory_order_release);
+   if(m_SinkCount.load(std::memory_order_relaxed) < slot + 1)
+      m_SinkCount.store(slot + 1, std::memory_order_release);
+   pthread_mutex_unlock(&m_SinkMutex);
+   return true;
+}
+
+///
+/// Unregisters a sink once its queue is written out. The sink itself is not deleted.
+///
+void Logger::removeSink(LogSink* sink)
+{
+   pthread_mutex_lock(&m_SinkMutex);
+   SinkQueue* queue = NULL;
+   for(size_t i = 0; i < MAX_LOG_SINKS && queue == NULL; ++i)
+   {
+      SinkQueue* used = m_Sinks[i].load(std::memory_order_relaxed);
+      if(used && used->sink == sink)
+      {
+         queue = used;
+         m_Sinks[i].store(NULL, std::memory_order_release);
+      }
+   }
+
+   size_t count = m_SinkCount.load(std::memory_order_relaxed);
+   while(count > 0 && m_Sinks[count - 1].load(std::memory_order_relaxed) == NULL)
+      --count;
+   m_SinkCount.store(count, std::memory_order_release);
+   pthread_mutex_unlock(&m_SinkMutex);
+
+   if(queue == NULL)
+      return;
+
+   pthread_mutex_lock(&queue->wakeMutex);
+   queue->running.store(false);
+   pthread_cond_broadcast(&queue->wakeCond);
+   pthread_mutex_unlock(&queue->wakeMutex);
+   pthread_join(queue->thread, NULL);
+
+   // A producer that loaded the slot before it was cleared may still push, so the queue
+   // outlives the call. Whatever lands in it from now on is released by ~SinkQueue.
+   pthread_mutex_lock(&m_SinkMutex);
+   m_RetiredSinks.push_back(queue);
+   pthread_mutex_unlock(&m_SinkMutex);
+}
+
+void Logger::setSinkLogLevel(LogSink* sink, LOG_LEVEL level)
+{
+   SinkQueue* queue = findSink(sink);
+   if(queue)
+      queue->level.store(level, std::memory_order_relaxed);
+}
+
+uint64_t Logger::getSinkDroppedCount(LogSink* sink)
+{
+   SinkQueue* queue = findSink(sink);
+   return queue ? queue->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+Logger::SinkQueue* Logger::findSink(LogSink* sink)
+{
+   pthread_mutex_lock(&m_SinkMutex);
+   SinkQueue* found = NULL;
+   for(size_t i = 0; i < MAX_LOG_SINKS && found == NULL; ++i)
+   {
+      SinkQueue* used = m_Sinks[i].load(std::memory_order_relaxed);
+      if(used && used->sink == sink)
+         found = used;
+   }
+   pthread_mutex_unlock(&m_SinkMutex);
+   return found;
+}
+
+Logger::SinkQueue::SinkQueue(LogSink* s, LOG_LEVEL l, size_t capacity, OverflowPolicy p)
+  : sink(s), level(l), policy(p), queue(capacity), dropped(0), running(false), flushRequest(0), flushAck(0)
+{
+   pthread_mutex_init(&wakeMutex, NULL);
+   pthread_cond_init(&wakeCond, NULL);
+}
+
+Logger::SinkQueue::~SinkQueue()
+{
+   auto release = [](LogLine*& line) { line->release(); };
+   while(queue.tryPop(release))
+   {
+   }
+   pthread_cond_destroy(&wakeCond);
+   pthread_mutex_destroy(&wakeMutex);
+}
+
+///
+/// Formats the record once and hands a reference to every sink that wants its level
+///
+void Logger::fanOut(LOG_LEVEL level, std::string_view timestamp, std::string_view text)
+{
+   LogLine* line = NULL;
+   const size_t count = m_SinkCount.load(std::memory_order_acquire);
+   for(size_t i = 0; i < count; ++i)
+   {
+      SinkQueue* sink = m_Sinks[i].load(std::memory_order_acquire);
+      if(sink == NULL || level > sink->level.load(std::memory_order_relaxed))
+         continue;
+
+      if(line == NULL)
+      {
+         line = LogLine::create(level, timestamp, text);
+         if(line == NULL)
+            return;
+      }
+      line->retain();
+      pushToSink(sink, line);
+   }
+
+   if(line)
+      line->release();
+}
+
+///
+/// Queues one reference for a sink, applying the sink's overflow policy
+///
+void Logger::pushToSink(SinkQueue* sink, LogLine* line)
+{
+   auto fill = [line](LogLine*& slot) { slot = line; };
+   ThreadStats* stats  = threadStats();
+   bool         waited = false;
+   while(!sink->queue.tryPush(fill))
+   {
+      if(sink->policy == OVERFLOW_DROP_NEWEST || !sink->running.load(std::memory_order_relaxed))
+      {
+         sink->dropped.fetch_add(1, std::memory_order_relaxed);
+         if(stats)
+            stats->droppedNewest.add(1);
+         line->release();
+         return;
+      }
+      else if(sink->policy == OVERFLOW_DROP_OLDEST)
+      {
+         auto discard = [](LogLine*& oldest) { oldest->release(); };
+         if(sink->queue.tryPop(discard))
+         {
+            sink->dropped.fetch_add(1, std::memory_order_relaxed);
+            if(stats)
+               stats->droppedOldest.add(1);
+         }
+      }
+      else
+      {
+         if(stats && !waited)
+            stats->blocked.add(1);
+         waited = true;
+         sched_yield();
+      }
+   }
+
+   if(stats)
+      noteHighWater(m_SinkHighWater, sink->queue.size());
+}
+
+///
+/// Waits until every sink has written what was queued before this call
+///
+void Logger::flushSinks()
+{
+   pthread_mutex_lock(&m_SinkMutex);
+   const size_t count = m_SinkCount.load(std::memory_order_relaxed);
+   uint64_t tickets[MAX_LOG_SINKS];
+   for(size_t i = 0; i < count; ++i)
+   {
+      SinkQueue* sink = m_Sinks[i].load(std::memory_order_relaxed);
+      if(sink == NULL)
+         continue;
+
+      pthread_mutex_lock(&sink->wakeMutex);
+      tickets[i] = sink->flushRequest.fetch_add(1) + 1;
+      pthread_cond_broadcast(&sink->wakeCond);
+      pthread_mutex_unlock(&sink->wakeMutex);
+   }
+
+   // removeSink() waits for m_SinkMutex, so the queues stay valid meanwhile
+   for(size_t i = 0; i < count; ++i)
+   {
+      SinkQueue* sink = m_Sinks[i].load(std::memory_order_relaxed);
+      if(sink == NULL)
+         continue;
+
+      pthread_mutex_lock(&sink->wakeMutex);
+      while(sink->flushAck.load() < tickets[i] && sink->running.load())
+         pthread_cond_wait(&sink->wakeCond, &sink->wakeMutex);
+      pthread_mutex_unlock(&sink->wakeMutex);
+   }
+   pthread_mutex_unlock(&m_SinkMutex);
+}
+
+///
+/// Writes out what is queued for one sink, at most one queue's worth per pass like drainQueue()
+///
+void Logger::drainSink(SinkQueue* sink)
+{
+   const uint64_t request = sink->flushRequest.load(std::memory_order_acquire);
+   bool wrote = false;
+
+   // Lines go back to the producers' pools together, once per drain
+   RecordPool::FreeBatch freed;
+   auto write = [sink, &freed](LogLine*& line)
+   {
+      sink->sink->write(*line);
+      line->release(freed);
+   };
+   size_t budget = sink->queue.capacity();
+   while(budget > 0)
+   {
+      if(sink->queue.tryPop(write))
+      {
+         wrote = true;
+         --budget;
+      }
+      else if(sink->queue.empty())
+      {
+         break;
+      }
+      else
+      {
+         sched_yield();
+      }
+   }
+
+   if(wrote || request != sink->flushAck.load(std::memory_order_relaxed))
+      sink->sink->flush();
+
+   if(request != sink->flushAck.load(std::memory_order_relaxed))
+   {
+      pthread_mutex_lock(&sink->wakeMutex);
+      sink->flushAck.store(request);
+      pthread_cond_broadcast(&sink->wakeCond);
+      pthread_mutex_unlock(&sink->wakeMutex);
+   }
+}
+
+///
+/// Body of a sink thread, the same polling loop as the writer thread
+///
+void* Logger::sinkThread(void* arg)
+{
+   SinkQueue* sink = static_cast<SinkQueue*>(arg);
+
+   while(sink->running.load())
+   {
+      drainSink(sink);
+      sink->sink->idle();
+
+      pthread_mutex_lock(&sink->wakeMutex);
+      if(sink->running.load() && sink->queue.empty() &&
+         sink->flushRequest.load() == sink->flushAck.load())
+      {
+         const struct timespec deadline = deadlineIn(1000);
+         pthread_cond_timedwait(&sink->wakeCond, &sink->wakeMutex, &deadline);
+      }
+      pthread_mutex_unlock(&sink->wakeMutex);
+   }
+
+   // Final drain on removal
+   drainSink(sink);
+   return NULL;
+}
+
+///
+/// Returns the calling thread's counter block, taking one on first use. Threads beyond
+/// MAX_STATS_THREADS live ones are not counted.
+///
+ThreadStats* Logger::acquireStats()
+{
+   ThreadStats*& block = t_Stats.block[m_Index];
+   if(block == NULL)
+      block = m_Stats.acquire();
+   return block;
+}
+
+///
+/// Raises a high-water mark to 'depth'. The common case, no new maximum, is a single load.
+///
+void Logger::noteHighWater(std::atomic<uint64_t>& highWater, uint64_t depth)
+{
+   uint64_t seen = highWater.load(std::memory_order_relaxed);
+   while(depth > seen && !highWater.compare_exchange_weak(seen, depth, std::memory_order_relaxed))
+   {
+   }
+}
+
+void Logger::countBytes(size_t bytes)
+{
+   ThreadStats* stats = threadStats();
+   if(stats)
+      stats->bytesWritten.add(bytes);
+}
+
+///
+/// Switches the counters on and starts the report thread when a periodic report is asked for
+///
+void Logger::enableStats(unsigned reportIntervalMs, StatsReport report, const std::string& path)
+{
+   disableStats();
+   m_StatsEnabled.store(true, std::memory_order_relaxed);
+
+   if(reportIntervalMs == 0 || report == STATS_REPORT_NONE)
+      return;
+
+   if(report == STATS_REPORT_PROMETHEUS && path.empty())
+   {
+      printf("Logger::enableStats() -- No file for the Prometheus report, only keeping the counters!!\n");
+      return;
+   }
+
+   m_StatsReport     = report;
+   m_StatsPath       = path;
+   m_StatsIntervalMs = reportIntervalMs;
+   m_StatsWakeFd     = eventfd(0, EFD_CLOEXEC);
+
+   m_StatsRunning.store(true);
+   if(pthread_create(&m_StatsThread, NULL, &Logger::statsThread, this) != 0)
+   {
+      printf("Logger::enableStats() -- Stats thread not created, only keeping the counters!!\n");
+      m_StatsRunning.store(false);
+      close(m_StatsWakeFd);
+      m_StatsWakeFd = -1;
+      return;
+   }
+   pinBackend(m_StatsThread);
+}
+
+void Logger::disableStats()
+{
+   m_StatsEnabled.store(false, std::memory_order_relaxed);
+   if(!m_StatsRunning.load())
+      return;
+
+   m_StatsRunning.store(false);
+   uint64_t one = 1;
+   if(write(m_StatsWakeFd, &one, sizeof(one)) < 0)
+   {
+      // The thread still notices within one report interval
+   }
+   pthread_join(m_StatsThread, NULL);
+
+   close(m_StatsWakeFd);
+   m_StatsWakeFd = -1;
+}
+
+///
+/// Sums the per-thread counters
+///
+LogStats Logger::stats() const
+{
+   LogStats snapshot;
+   m_Stats.forEach([&snapshot](const ThreadStats* block) { snapshot.add(*block); });
+
+   snapshot.queueDepth         = m_QueueDepth.load(std::memory_order_relaxed);
+   snapshot.queueHighWater     = m_QueueHighWater.load(std::memory_order_relaxed);
+   snapshot.sinkQueueHighWater = m_SinkHighWater.load(std::memory_order_relaxed);
+   return snapshot;
+}
+
+///
+/// One periodic report. The Prometheus file is written next to its final name and renamed,
+/// so a scraper never reads half of it.
+///
+void Logger::reportStats()
+{
+   const LogStats snapshot = stats();
+
+   if(m_StatsReport == STATS_REPORT_LOG)
+   {
+      if(!isEnabled(LOG_LEVEL_INFO))
+         return;
+
+      format line(INFO_TAG "Logger::stats() - ");
+      snapshot.summary(line);
+      log_direct(LOG_LEVEL_INFO, line.view());
+      return;
+   }
+
+   format text;
+   snapshot.prometheus(text);
+
+   const string temporary = m_StatsPath + ".tmp";
+   int fd = open(temporary.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+   if(fd < 0)
+   {
+      printf("Logger::reportStats() -- Unable to open %s!!\n", temporary.c_str());
+      return;
+   }
+
+   struct iovec iov;
+   iov.iov_base = (void*)text.view().data();
+   iov.iov_len  = text.view().size();
+   writeFully(fd, &iov, 1);
+   close(fd);
+
+   if(rename(temporary.c_str(), m_StatsPath.c_str()) != 0)
+      printf("Logger::reportStats() -- Unable to rename %s!!\n", temporary.c_str());
+}
+
+///
+/// Body of the stats thread
+///
+void* Logger::statsThread(void* arg)
+{
+   Logger* logger = static_cast<Logger*>(arg);
+
+   struct pollfd wake;
+   wake.fd     = logger->m_StatsWakeFd;
+   wake.events = POLLIN;
+
+   while(logger->m_StatsRunning.load())
+   {
+      poll(&wake, 1, (int)logger->m_StatsIntervalMs);
+      if(logger->m_StatsRunning.load())
+         logger->reportStats();
+   }
+   return NULL;
+}
@@ -7,11 +7,36 @@
 #include <sstream>
 #include <string>
 #include <typeinfo>
+#include <atomic>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 // POSIX Socket Header File(s)
 #include <errno.h>
 #include <pthread.h>
 #include "Utils.h"
+#include "RingBuffer.h"
+#include "LogFormatter.h"
+#include "BinaryLog.h"
+#include "ThreadBuffer.h"
+#include "Timestamp.h"
+#include "MappedFile.h"
+#include "LogArchiver.h"
+#include "LogSampler.h"
+#include "HexDump.h"
+#include "StructuredFormat.h"
+#include "LogSink.h"
+#include "NetworkSink.h"
+#include "FlightRecorder.h"
+#include "FormatString.h"
+#include "LogStats.h"
+#include "TraceExport.h"
+#include "ConsoleOutput.h"
+#include "CpuAffinity.h"
+#include "FileWriter.h"
+#include "WriteFully.h"
 
 using namespace utils;
 
@@ -38,19 +63,211 @@ namespace CPlusPlusLogging
     #define eprintf(...) fprintf (stderr, __VA_ARGS__)
     // eprintf ("%s:%d: ", input_file, lineno)
 
+    /// Compile-time ceiling for log statements, using the LOG_LEVEL values. Statements above it are
+    /// removed by the preprocessor, e.g. -DLOG_COMPILE_LEVEL=4 strips DEBUG, TRACE and BUFFER logging
+    /// from release builds.
+    ///
+    #ifndef LOG_COMPILE_LEVEL
+    #define LOG_COMPILE_LEVEL   8
+    #endif
+
+    #define LOG_LIKELY(x)       __builtin_expect(!!(x), 1)
+    #define LOG_UNLIKELY(x)     __builtin_expect(!!(x), 0)
+    #define LOG_DISCARD(...)    do { } while (0)
+
+    /// Compile-time descriptor of the calling function, one per call site
+    ///
+    #define LOG_SITE_HERE(level) \
+        static constexpr LogSite _log_site_(level, __FILE__, __LINE__, __PRETTY_FUNCTION__, __FUNCTION__)
+
+    /// The runtime level, or the override for the caller's class, is tested before any of the
+    /// arguments are evaluated
+    ///
+    #define LOG_TO_AT_LEVEL(logger, level, ...) \
+        do { \
+            Logger* _logger_ = (logger); \
+            LOG_SITE_HERE(level); \
+            if (LOG_UNLIKELY(_logger_->isEnabled(_log_site_))) \
+                _logger_->user_log(&_log_site_, __VA_ARGS__); \
+        } while (0)
+
+    #define LOG_AT_LEVEL(level, ...) \
+        LOG_TO_AT_LEVEL(Logger::getInstance(), level, __VA_ARGS__)
+
+    /// Format string variant, e.g. LOG_INFO_F("conn {} took {}us", id, dt). The string is parsed
+    /// at compile time, a wrong number of arguments or a stray brace does not compile.
+    ///
+    #define LOG_F_TO_AT_LEVEL(logger, level, fmt, ...) \
+        do { \
+            Logger* _logger_ = (logger); \
+            LOG_SITE_HERE(level); \
+            struct _log_format_ { static constexpr std::string_view value() { return fmt; } }; \
+            if (LOG_UNLIKELY(_logger_->isEnabled(_log_site_))) \
+                _logger_->format_log<_log_format_>(&_log_site_, ##__VA_ARGS__); \
+        } while (0)
+
+    #define LOG_F_AT_LEVEL(level, fmt, ...) \
+        LOG_F_TO_AT_LEVEL(Logger::getInstance(), level, fmt, ##__VA_ARGS__)
+
+    /// LOG_BUFFER(text) logs a string as it is, LOG_BUFFER(ptr, len) a hexdump of 'len' bytes
+    /// when 'ptr' is a void or unsigned char pointer, a char* is formatted like any other text
+    ///
+    #define BUFFER_AT_LEVEL(level, ...) \
+        do { \
+            Logger* _logger_ = Logger::getInstance(); \
+            if (LOG_UNLIKELY(_logger_->isEnabled(level))) \
+                _logger_->buffer_log(level, __VA_ARGS__); \
+        } while (0)
+
+    /// Sampled logging: 'check' is a LogSampler call on the site's own sampler. Suppressed calls
+    /// stop after the sampler's atomics, before any argument is evaluated.
+    ///
+    #define LOG_SAMPLED_AT_LEVEL(level, check, ...) \
+        do { \
+            Logger* _logger_ = Logger::getInstance(); \
+            LOG_SITE_HERE(level); \
+            static LogSampler _log_sampler_; \
+            if (LOG_UNLIKELY((level) <= LOG_COMPILE_LEVEL && _logger_->isEnabled(_log_site_))) \
+            { \
+                uint64_t _log_skipped_; \
+                const bool _log_pass_ = _log_sampler_.check; \
+                if (_log_skipped_ != 0) \
+                    _logger_->log_suppressed(&_log_site_, _log_skipped_); \
+                if (_log_pass_) \
+                    _logger_->user_log(&_log_site_, __VA_ARGS__); \
+            } \
+        } while (0)
+
+    /// e.g. LOG_EVERY_N(LOG_LEVEL_WARNING, 1000, "backend down", err)
+    ///
+    #define LOG_EVERY_N(level, n, ...) \
+        LOG_SAMPLED_AT_LEVEL(level, everyN(n, _log_skipped_), __VA_ARGS__)
+    #define LOG_FIRST_N(level, n, ...) \
+        LOG_SAMPLED_AT_LEVEL(level, firstN(n, _log_skipped_), __VA_ARGS__)
+    #define LOG_EVERY_MS(level, ms, ...) \
+        LOG_SAMPLED_AT_LEVEL(level, everyMs(ms, _log_skipped_), __VA_ARGS__)
+    #define LOG_RATE_LIMITED(level, perSecond, burst, ...) \
+        LOG_SAMPLED_AT_LEVEL(level, rateLimited(perSecond, burst, _log_skipped_), __VA_ARGS__)
+
+    #define LOG_CONCAT_(a, b)   a##b
+    #define LOG_CONCAT(a, b)    LOG_CONCAT_(a, b)
+
+    /// Timed scope: the clock is read when the scope is entered and one record, "<name> took
+    /// 12.345us", is logged when it is left. The level is checked on entry, a disabled scope
+    /// costs that check only. Above LOG_COMPILE_LEVEL the scope object is empty.
+    ///
+    #define LOG_TIMED_TO_AT_LEVEL(logger, level, name) \
+        static constexpr LogSite LOG_CONCAT(_log_scope_site_, __LINE__)( \
+            level, __FILE__, __LINE__, __PRETTY_FUNCTION__, __FUNCTION__); \
+        LogScope<((level) <= LOG_COMPILE_LEVEL)> LOG_CONCAT(_log_scope_, __LINE__)( \
+            logger, &LOG_CONCAT(_log_scope_site_, __LINE__), name)
+
+    /// e.g. LOG_TIMED(LOG_LEVEL_DEBUG, "load config") or LOG_SCOPE("parse") at TRACE, one per line
+    ///
+    #define LOG_TIMED(level, name)  LOG_TIMED_TO_AT_LEVEL(NULL, level, name)
+    #define LOG_SCOPE(name)         LOG_TIMED_TO_AT_LEVEL(NULL, LOG_LEVEL_TRACE, name)
+    #define LOG_TIMED_TO(logger, level, name) \
+        LOG_TIMED_TO_AT_LEVEL(logger, level, name)
+
     /// Direct Interface for logging into log file or console using variadic MACRO(s)
     ///
-    #define LOG_ALWAYS(...)     Logger::getInstance()->user_log(LOG_LEVEL_FATAL,   __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_FATAL(...)      Logger::getInstance()->user_log(LOG_LEVEL_FATAL,   __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_ERROR(...)      Logger::getInstance()->user_log(LOG_LEVEL_ERROR,   __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_WARNING(...)    Logger::getInstance()->user_log(LOG_LEVEL_WARNING, __PRETTY_FUNCTION__, __FUNCTION__ , __VA_ARGS__)
-    #define LOG_INFO(...)       Logger::getInstance()->user_log(LOG_LEVEL_INFO,    __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_DEBUG(...)      Logger::getInstance()->user_log(LOG_LEVEL_DEBUG,   __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_TRACE(...)      Logger::getInstance()->user_log(LOG_LEVEL_TRACE,   __PRETTY_FUNCTION__, __FUNCTION__, __VA_ARGS__)
-    #define LOG_BUFFER(...)     Logger::getInstance()->buffer_log(LOG_LEVEL_BUFFER, __VA_ARGS__)
+    #define LOG_ALWAYS(...)     LOG_AT_LEVEL(LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    #define LOG_ALWAYS_F(...)   LOG_F_AT_LEVEL(LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    /// The same for a named logger, e.g. LOG_INFO_TO(access, "GET", path, status) with a handle
+    /// from Logger::get("access") that was looked up once
+    ///
+    #define LOG_ALWAYS_TO(logger, ...)    LOG_TO_AT_LEVEL(logger, LOG_LEVEL_FATAL, __VA_ARGS__)
+    #define LOG_ALWAYS_F_TO(logger, ...)  LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    #if LOG_COMPILE_LEVEL >= 1
+    #define LOG_FATAL(...)      LOG_AT_LEVEL(LOG_LEVEL_FATAL, __VA_ARGS__)
+    #define LOG_FATAL_F(...)    LOG_F_AT_LEVEL(LOG_LEVEL_FATAL, __VA_ARGS__)
+    #define LOG_FATAL_TO(logger, ...)     LOG_TO_AT_LEVEL(logger, LOG_LEVEL_FATAL, __VA_ARGS__)
+    #define LOG_FATAL_F_TO(logger, ...)   LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_FATAL, __VA_ARGS__)
+    #else
+    #define LOG_FATAL(...)      LOG_DISCARD(__VA_ARGS__)
+    #define LOG_FATAL_F(...)    LOG_DISCARD(__VA_ARGS__)
+    #define LOG_FATAL_TO(...)             LOG_DISCARD(__VA_ARGS__)
+    #define LOG_FATAL_F_TO(...)           LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #if LOG_COMPILE_LEVEL >= 2
+    #define LOG_ERROR(...)      LOG_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define LOG_ERROR_F(...)    LOG_F_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define LOG_ERROR_TO(logger, ...)     LOG_TO_AT_LEVEL(logger, LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define LOG_ERROR_F_TO(logger, ...)   LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_ERROR, __VA_ARGS__)
+    #else
+    #define LOG_ERROR(...)      LOG_DISCARD(__VA_ARGS__)
+    #define LOG_ERROR_F(...)    LOG_DISCARD(__VA_ARGS__)
+    #define LOG_ERROR_TO(...)             LOG_DISCARD(__VA_ARGS__)
+    #define LOG_ERROR_F_TO(...)           LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #if LOG_COMPILE_LEVEL >= 3
+    #define LOG_WARNING(...)    LOG_AT_LEVEL(LOG_LEVEL_WARNING, __VA_ARGS__)
+    #define LOG_WARNING_F(...)  LOG_F_AT_LEVEL(LOG_LEVEL_WARNING, __VA_ARGS__)
+    #define LOG_WARNING_TO(logger, ...)   LOG_TO_AT_LEVEL(logger, LOG_LEVEL_WARNING, __VA_ARGS__)
+    #define LOG_WARNING_F_TO(logger, ...) LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_WARNING, __VA_ARGS__)
+    #else
+    #define LOG_WARNING(...)    LOG_DISCARD(__VA_ARGS__)
+    #define LOG_WARNING_F(...)  LOG_DISCARD(__VA_ARGS__)
+    #define LOG_WARNING_TO(...)           LOG_DISCARD(__VA_ARGS__)
+    #define LOG_WARNING_F_TO(...)         LOG_DISCARD(__VA_ARGS__)
+    #endif
 
-    #define UPDATE_LOG_LEVEL(y) Logger::getInstance()->updateLogLevel(y);
-    #define UPDATE_LOG_TYPE(y)  Logger::getInstance()->updateLogType(y);
+    #if LOG_COMPILE_LEVEL >= 4
+    #define LOG_INFO(...)       LOG_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+    #define LOG_INFO_F(...)     LOG_F_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+    #define LOG_INFO_TO(logger, ...)      LOG_TO_AT_LEVEL(logger, LOG_LEVEL_INFO, __VA_ARGS__)
+    #define LOG_INFO_F_TO(logger, ...)    LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_INFO, __VA_ARGS__)
+    #else
+    #define LOG_INFO(...)       LOG_DISCARD(__VA_ARGS__)
+    #define LOG_INFO_F(...)     LOG_DISCARD(__VA_ARGS__)
+    #define LOG_INFO_TO(...)              LOG_DISCARD(__VA_ARGS__)
+    #define LOG_INFO_F_TO(...)            LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #if LOG_COMPILE_LEVEL >= 5
+    #define LOG_DEBUG(...)      LOG_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_DEBUG_F(...)    LOG_F_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_DEBUG_TO(logger, ...)     LOG_TO_AT_LEVEL(logger, LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_DEBUG_F_TO(logger, ...)   LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #else
+    #define LOG_DEBUG(...)      LOG_DISCARD(__VA_ARGS__)
+    #define LOG_DEBUG_F(...)    LOG_DISCARD(__VA_ARGS__)
+    #define LOG_DEBUG_TO(...)             LOG_DISCARD(__VA_ARGS__)
+    #define LOG_DEBUG_F_TO(...)           LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #if LOG_COMPILE_LEVEL >= 6
+    #define LOG_TRACE(...)      LOG_AT_LEVEL(LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define LOG_TRACE_F(...)    LOG_F_AT_LEVEL(LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define LOG_TRACE_TO(logger, ...)     LOG_TO_AT_LEVEL(logger, LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define LOG_TRACE_F_TO(logger, ...)   LOG_F_TO_AT_LEVEL(logger, LOG_LEVEL_TRACE, __VA_ARGS__)
+    #else
+    #define LOG_TRACE(...)      LOG_DISCARD(__VA_ARGS__)
+    #define LOG_TRACE_F(...)    LOG_DISCARD(__VA_ARGS__)
+    #define LOG_TRACE_TO(...)             LOG_DISCARD(__VA_ARGS__)
+    #define LOG_TRACE_F_TO(...)           LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #if LOG_COMPILE_LEVEL >= 7
+    #define LOG_BUFFER(...)     BUFFER_AT_LEVEL(LOG_LEVEL_BUFFER, __VA_ARGS__)
+    #define LOG_BUFFER_RAW(data, length) \
+        do { \
+            Logger* _logger_ = Logger::getInstance(); \
+            if (LOG_UNLIKELY(_logger_->isEnabled(LOG_LEVEL_BUFFER))) \
+                _logger_->buffer_raw(data, length); \
+        } while (0)
+    #else
+    #define LOG_BUFFER(...)     LOG_DISCARD(__VA_ARGS__)
+    #define LOG_BUFFER_RAW(...) LOG_DISCARD(__VA_ARGS__)
+    #endif
+
+    #define UPDATE_LOG_LEVEL(y) Logger::getInstance()->setLogLevel(y);
+    #define UPDATE_LOG_TYPE(y)  Logger::getInstance()->setLogType(y);
 
     // enum for LOG_TYPE
     typedef enum LOG_TYPE
@@ -58,40 +275,310 @@ namespace CPlusPlusLogging
       NO_LOG            = 1,
       CONSOLE           = 2,
       FILE_LOG          = 3,
+      MMAP_FILE_LOG     = 4,        // Log file written through a memory mapping, see MappedFile
     } LogType;
 
+    // enum for the behaviour of the asynchronous queue when it is full
+    typedef enum LOG_OVERFLOW_POLICY
+    {
+      OVERFLOW_BLOCK       = 1,     // Producer sleeps until the writer thread frees a slot.
+      OVERFLOW_DROP_NEWEST = 2,     // The record being logged is discarded.
+      OVERFLOW_DROP_OLDEST = 3,     // The oldest queued record is discarded to make room.
+    } OverflowPolicy;
+
+    // enum for how records travel through the asynchronous queue
+    typedef enum LOG_ENCODING
+    {
+      ENCODE_TEXT       = 1,        // Caller formats the text line (default).
+      ENCODE_DEFERRED   = 2,        // Caller stores raw arguments, the writer thread formats the text line.
+      ENCODE_BINARY     = 3,        // Caller stores raw arguments, the writer thread appends them to the binary
+                                    // log file (LOG_FILE_NAME ".bin") for offline decoding with LogDecoder.
+    } LogEncoding;
+
+    // enum for the layout of the text records
+    typedef enum LOG_FORMAT
+    {
+      FORMAT_TEXT       = 1,        // "<timestamp>  [LEVEL]: Class::func() - message" (default).
+      FORMAT_JSON       = 2,        // One JSON object per line (JSON lines).
+      FORMAT_LOGFMT     = 3,        // key=value pairs, one record per line.
+    } LogFormat;
+
+    // enum for how the writer thread waits for records, see Logger::setWriterBackoff()
+    typedef enum WRITER_BACKOFF
+    {
+      BACKOFF_POLL      = 1,        // Checks the queue every millisecond, producers never signal (default).
+      BACKOFF_SPIN      = 2,        // Busy-spins on the queue: lowest latency, keeps a core busy, pin it.
+      BACKOFF_BLOCK     = 3,        // Waits on a futex until a producer finds it idle and wakes it.
+      BACKOFF_SLEEP     = 4,        // Sleeps a fixed interval between passes, producers never wake it.
+    } WriterBackoff;
+
+    // Default number of records the asynchronous queue can hold
+    #define DEFAULT_ASYNC_QUEUE_SIZE 8192
+
+    // Pass interval of BACKOFF_SLEEP, and how often an idle BACKOFF_BLOCK writer still wakes up
+    // for the flush interval, rotation and partly filled batch buffers
+    #define DEFAULT_WRITER_SLEEP_US         1000
+    #define WRITER_IDLE_TIMEOUT_MS          100
+
+    // Defaults of the file flush policy, see Logger::setFlushPolicy()
+    #define DEFAULT_FILE_BUFFER_SIZE        (256 * 1024)
+    #define DEFAULT_FLUSH_BYTES             (64 * 1024)
+    #define DEFAULT_FLUSH_INTERVAL_MS       1000
+    #define DEFAULT_FLUSH_LEVEL             LOG_LEVEL_ERROR
+
+    // Settings file check interval, see Logger::enableConfigReload()
+    #define DEFAULT_CONFIG_POLL_MS          1000
+
+    // Rotated log files kept by default, see Logger::setRotationPolicy()
+    #define DEFAULT_ROTATION_KEEP           10
+
+    // Sinks the fan-out can hold and the default queue size of each, see Logger::addSink()
+    #define MAX_LOG_SINKS                   8
+    #define DEFAULT_SINK_QUEUE_SIZE         4096
+
+    // Alternate signal stack and backtrace frames of the crash handler, see Logger::installCrashHandler()
+    #define CRASH_STACK_SIZE                (64 * 1024)
+    #define CRASH_BACKTRACE_DEPTH           64
+
+    // Loggers that can exist at the same time, getInstance() included, see Logger::get()
+    #define MAX_LOGGERS                     16
+
+    // Tags that are logged as per user's will
+    #define ALWAYS_TAG "[ALWAYS]: "
+    #define FATAL_TAG "[FATAL]: "
+    #define ERROR_TAG "[ERROR]: "
+    #define WARNING_TAG "[WARNING]: "
+    #define INFO_TAG "[INFO]: "
+    #define DEBUG_TAG "[DEBUG]: "
+    #define TRACE_TAG "[TRACE]: "
+
+    // Room for the prebuilt "[LEVEL]: Class::func() - " prefix of a call site
+    #define LOG_SITE_PREFIX_SIZE 128
+
+    // Room for the pre-escaped level/class/func fields of a call site, see setLogFormat()
+    #define LOG_SITE_FIELDS_SIZE 160
+
+    ///
+    /// Everything known about a log statement at compile time. The LOG_* macros create one
+    /// constexpr instance per call site, so the class name is parsed out of __PRETTY_FUNCTION__
+    /// by the compiler and the record prefix is already rendered when the program starts.
+    ///
+    struct LogSite
+    {
+        LOG_LEVEL        level;
+        const char*      file;
+        int              line;
+        std::string_view className;
+        std::string_view function;
+        std::string_view tag;
+        size_t           prefixLength;
+        char             prefix[LOG_SITE_PREFIX_SIZE];
+
+        // The same fields, escaped for the structured formats:
+        //   "level":"INFO","class":"Foo","func":"run"   and   level=INFO class=Foo func=run
+        size_t           jsonLength;
+        char             json[LOG_SITE_FIELDS_SIZE];
+        size_t           logfmtLength;
+        char             logfmt[LOG_SITE_FIELDS_SIZE];
+
+        // Effective level of this site, "generation << 8 | level", see Logger::isEnabled(const LogSite&)
+        mutable std::atomic<uint64_t> levelCache;
+
+        constexpr LogSite(LOG_LEVEL lvl, const char* fileName, int lineNo,
+                          std::string_view prettyFunc, std::string_view funcName)
+           : level(lvl), file(fileName), line(lineNo),
+             className(parseClassName(prettyFunc, funcName)), function(funcName),
+             tag(levelTag(lvl)), prefixLength(0), prefix(),
+             jsonLength(0), json(), logfmtLength(0), logfmt(), levelCache(0)
+        {
+            append(tag);
+            if (!className.empty())
+            {
+                append(className);
+                append("::");
+            }
+            append(function);
+            append("() - ");
+
+            // Tags look like "[INFO]: "
+            const std::string_view name = tag.empty() ? std::string_view() : tag.substr(1, tag.size() - 4);
+
+            put(json, jsonLength, "\"level\":\"");
+            putEscaped(json, jsonLength, name, false);
+            put(json, jsonLength, "\",\"class\":\"");
+            putEscaped(json, jsonLength, className, false);
+            put(json, jsonLength, "\",\"func\":\"");
+            putEscaped(json, jsonLength, function, false);
+            put(json, jsonLength, "\"");
+
+            put(logfmt, logfmtLength, "level=");
+            putEscaped(logfmt, logfmtLength, name, true);
+            put(logfmt, logfmtLength, " class=");
+            putEscaped(logfmt, logfmtLength, className, true);
+            put(logfmt, logfmtLength, " func=");
+            putEscaped(logfmt, logfmtLength, function, true);
+        }
+
+        std::string_view prefixView() const { return std::string_view(prefix, prefixLength); }
+        std::string_view jsonView() const { return std::string_view(json, jsonLength); }
+        std::string_view logfmtView() const { return std::string_view(logfmt, logfmtLength); }
+
+        static constexpr std::string_view levelTag(LOG_LEVEL lvl)
+        {
+            switch (lvl)
+            {
+                case ALWAYS_LOG_THIS:   return ALWAYS_TAG;
+                case LOG_LEVEL_FATAL:   return FATAL_TAG;
+                case LOG_LEVEL_ERROR:   return ERROR_TAG;
+                case LOG_LEVEL_WARNING: return WARNING_TAG;
+                case LOG_LEVEL_INFO:    return INFO_TAG;
+                case LOG_LEVEL_DEBUG:   return DEBUG_TAG;
+                case LOG_LEVEL_TRACE:   return TRACE_TAG;
+                default:                return "";
+            }
+        }
+
+        ///
+        /// Returns the scope that directly owns the function, e.g. "Foo" for
+        /// "void ns::Foo::bar(int)" or "Tpl<T>" for "T Tpl<T>::get() [with T = int]".
+        /// Free functions (and lambdas) yield an empty class name.
+        ///
+        static constexpr std::string_view parseClassName(std::string_view pretty, std::string_view func)
+        {
+            // Template arguments are appended as " [with T = ...]", ignore them
+            const size_t with = pretty.find(" [with ");
+            if (with != std::string_view::npos)
+                pretty = pretty.substr(0, with);
+
+            // The last "::func(" is the function itself, not a namespace or class of the same name
+            const size_t len = func.size();
+            size_t end = std::string_view::npos;
+            for (size_t pos = 2; pos + len < pretty.size(); ++pos)
+            {
+                if (pretty[pos - 1] == ':' && pretty[pos - 2] == ':' &&
+                    (pretty[pos + len] == '(' || pretty[pos + len] == '<') &&
+                    pretty.substr(pos, len) == func)
+                {
+                    end = pos - 2;
+                }
+            }
+            if (end == std::string_view::npos)
+                return std::string_view();
+
+            size_t begin = end;
+            int depth = 0;
+            while (begin > 0)
+            {
+                const char c = pretty[begin - 1];
+                if (c == '>')
+                    ++depth;
+                else if (c == '<')
+                    --depth;
+                else if (depth == 0 && (c == ' ' || c == ':' || c == '*' || c == '&'))
+                    break;
+                --begin;
+            }
+            return pretty.substr(begin, end - begin);
+        }
+
+      private:
+        constexpr void append(std::string_view text)
+        {
+            for (size_t i = 0; i < text.size() && prefixLength < LOG_SITE_PREFIX_SIZE; ++i)
+                prefix[prefixLength++] = text[i];
+        }
+
+        static constexpr void put(char* out, size_t& length, std::string_view text)
+        {
+            for (size_t i = 0; i < text.size() && length < LOG_SITE_FIELDS_SIZE; ++i)
+                out[length++] = text[i];
+        }
+
+        ///
+        /// Names only ever need '"' and '\' escaped. For logfmt a value with a space, '"' or '='
+        /// (e.g. "Tpl<int, char>") or an empty one is quoted.
+        ///
+        static constexpr void putEscaped(char* out, size_t& length, std::string_view text, bool logfmt)
+        {
+            bool quote = !logfmt;
+            for (size_t i = 0; i < text.size(); ++i)
+                quote = quote || text[i] == ' ' || text[i] == '=' || text[i] == '"' || text[i] == '\\';
+            quote = quote || text.empty();
+
+            if (quote && logfmt)
+                put(out, length, "\"");
+            for (size_t i = 0; i < text.size(); ++i)
+            {
+                if (text[i] == '"' || text[i] == '\\')
+                    put(out, length, "\\");
+                put(out, length, text.substr(i, 1));
+            }
+            if (quote && logfmt)
+                put(out, length, "\"");
+        }
+    };
+
 
     class Logger
     {
       public:
-         static Logger* getInstance() throw ();
+         /// The process wide logger, created on first use. The local static makes the first call
+         /// thread safe, every later call inlines to the guard check and one load.
+         ///
+         static Logger* getInstance() throw ()
+         {
+             static Logger* const instance = createInstance();
+             return instance;
+         }
+
+         /// Named loggers, each with its own file, level and class overrides, flush policy,
+         /// queue or batches, sinks and stats, e.g. an access log kept apart from the error log.
+         /// The first call creates the logger, later calls return the same one, so look it up
+         /// once and keep the handle:
+         ///
+         ///     static Logger* const access = Logger::get("access", "access.log");
+         ///     LOG_INFO_TO(access, "GET", path, status);
+         ///
+         /// 'fileName' ("<name>.log" by default) only counts on the first call, give every
+         /// logger a file of its own. An empty name returns getInstance(), so does a call when
+         /// MAX_LOGGERS already exist. Loggers are never deleted.
+         ///
+         static Logger* get(const std::string& name, const std::string& fileName = "");
 
+         const std::string& name() const { return m_Name; }
+         const std::string& fileName() const { return m_FileName; }
+
+         /// "logging_level" from the settings file. The file is parsed once and cached, the
+         /// cache follows the file while enableConfigReload() is on.
          ///
          static const LOG_LEVEL getLogLevel() throw();
 
+         /// Cheap check used by the LOG_* macros before anything is formatted
+         ///
+         bool isEnabled(LOG_LEVEL level) const
+         {
+             return level <= m_LogLevel.load(std::memory_order_relaxed);
+         }
+
+         /// Same check for a call site, honouring the per-class overrides. The site caches its
+         /// effective level together with the generation it was resolved in, every level change
+         /// bumps the generation. So once resolved this is two loads and a compare.
+         ///
+         bool isEnabled(const LogSite& site)
+         {
+             const uint64_t cached = site.levelCache.load(std::memory_order_relaxed);
+             if (LOG_LIKELY((cached >> 8) == m_LevelGeneration.load(std::memory_order_relaxed)))
+                 return site.level <= (int8_t)(cached & 0xff);
+             return site.level <= resolveLevel(site);
+         }
+
          ///
          /// A generic printf type formatting to enable logging of multiple parameters
          ///
-         struct format {
-             std::ostringstream oss_;
-             format (std::string pretty_func, std::string func_name, LOG_LEVEL level)
-             {
-                 string data;
-                 data.append(Logger::getLogTypeTag(level));
-                 data.append(utils::Utils::className(pretty_func));
-                 data.append("::");
-                 data.append(func_name);
-                 data.append("() - ");
-
-                 oss_ << data;
-             }
-             format () { }
-             template <typename T>
-             format & operator % (T &&a) { oss_ << " " << a << ","; return *this; }
-         };
+         typedef LogFormatter format;
 
          template <typename T, typename... Params>
-         void fmt_logging (LOG_LEVEL level, format &fmt, T arg, Params... parameters) {
+         void fmt_logging (LOG_LEVEL level, format &fmt, const T& arg, const Params&... parameters) {
              fmt_logging(level, fmt % arg, parameters...);
          }
 
@@ -99,46 +586,132 @@ namespace CPlusPlusLogging
          {
              if (level == LOG_LEVEL_BUFFER)
              {
-                log_direct_buffer(fmt.oss_.str().data());
+                log_direct_buffer(fmt.view());
              }
              else
              {
-                log_direct(fmt.oss_.str());
+                log_direct(level, fmt.view());
              }
          }
 
-         /// Templated interface for custom logging
+         /// Templated interface for custom logging. Arguments are taken by reference; callables
+         /// and log_format() overloads are rendered as described in LogFormatDetail, e.g.
+         /// LOG_DEBUG("cache", [&] { return cache.dump(); }).
          ///
          template <typename T, typename... Params>
-         void user_log(LOG_LEVEL level,  std::string pretty_func, string func_name, T arg, Params... parameters)
+         void user_log(const LogSite* site, const T& arg, const Params&... parameters)
          {
-             if (m_LogLevel < level)
+             if (!isEnabled(*site))
+                 return;
+
+             if (m_Encoding.load(std::memory_order_relaxed) != ENCODE_TEXT && m_AsyncEnabled.load(std::memory_order_acquire))
+             {
+                 binary_log(site, arg, parameters...);
+                 return;
+             }
+
+             if (m_Format.load(std::memory_order_relaxed) != FORMAT_TEXT)
+             {
+                 structured_log(site, arg, parameters...);
+                 return;
+             }
+
+             fmt_logging(site->level, format(site->prefixView()) % arg, parameters...);
+         }
+
+         void user_log(const LogSite* site, const char* text) throw();
+
+         /// Backend of the LOG_*_F macros: 'Format' carries the format string as a constexpr
+         /// value(). Arguments are taken by reference and rendered with straight-line appends.
+         /// In the structured formats the rendered text is the "msg", the deferred and binary
+         /// encodings store it as a single text argument.
+         ///
+         template <typename Format, typename... Args>
+         void format_log(const LogSite* site, const Args&... args)
+         {
+             constexpr long count = FormatString::count(Format::value());
+             static_assert(count >= 0, "LOG_*_F: stray '{' or '}' in the format string, write {{ and }} for braces");
+             static_assert(count < 0 || (size_t)count == sizeof...(Args),
+                           "LOG_*_F: the number of {} placeholders does not match the number of arguments");
+
+             static constexpr CompiledFormat<(count < 0 ? 0 : count), Format::value().size()> compiled =
+                 FormatString::compile<(count < 0 ? 0 : count), Format::value().size()>(Format::value());
+
+             if (!isEnabled(*site))
+                 return;
+
+             if (m_Format.load(std::memory_order_relaxed) == FORMAT_TEXT &&
+                 (m_Encoding.load(std::memory_order_relaxed) == ENCODE_TEXT || !m_AsyncEnabled.load(std::memory_order_acquire)))
+             {
+                 format fmt(site->prefixView());
+                 compiled.render(fmt, args...);
+                 log_direct(site->level, fmt.view());
                  return;
+             }
 
-             fmt_logging(level, format(pretty_func, func_name, level) % arg, parameters...);
+             format message;
+             compiled.render(message, args...);
+             log_message(site, message.view());
          }
+         void log_suppressed(const LogSite* site, uint64_t count) throw();
 
-         void user_log(LOG_LEVEL level, std::string pretty_func, string func_name, const char* text) throw();
+         /// Backend of LOG_SCOPE/LOG_TIMED: the span's record, and its trace event while the
+         /// trace export is on. The structured formats get "span" and "dur_ns" fields.
+         ///
+         void log_span(const LogSite* site, std::string_view name, uint64_t startNs, uint64_t durationNs) throw();
          void user_log(LOG_LEVEL level, std::string data) throw();
 
          /// Templated interface for Buffer Log (special case)
          ///
          void buffer_log(LOG_LEVEL level, const char* text) throw();
 
+         /// A void or unsigned char (uint8_t) pointer followed by a length is a byte buffer and
+         /// logged as a hexdump, anything else, char* text included, is formatted like the other
+         /// log calls
+         ///
          template <typename T, typename... Params>
          void buffer_log (LOG_LEVEL level, T arg, Params... parameters)
          {
-             if (m_LogLevel < level)
+             if (!isEnabled(level))
                  return;
 
-             fmt_logging(format() % arg, parameters...);
+             if constexpr (sizeof...(Params) == 1 && IsBytePointer<T>::value && (std::is_integral<Params>::value && ...))
+                 buffer_dump(arg, (size_t)(parameters, ...));
+             else
+                 fmt_logging(level, format() % arg, parameters...);
          }
 
+         template <typename T>
+         struct IsBytePointer : std::false_type { };
+
+         template <typename T>
+         struct IsBytePointer<T*>
+           : std::integral_constant<bool, std::is_void<typename std::remove_cv<T>::type>::value ||
+                                          std::is_same<typename std::remove_cv<T>::type, unsigned char>::value> { };
+
+         /// Hexdump ("hexdump -C" layout) or the raw bytes of a buffer, NUL bytes included
+         ///
+         void buffer_dump(const void* data, size_t length) throw();
+         void buffer_raw(const void* data, size_t length) throw();
+
          /// Interface to control log levels
          ///
          void setLogLevel(LogLevel logLevel);
          void setLogType(LogType logType);
 
+         /// Level colours of the CONSOLE output (COLOR_NEVER by default). Whether standard output
+         /// is a terminal is checked again here and by setLogType(CONSOLE).
+         ///
+         void setConsoleColor(ConsoleColor mode);
+
+         /// Level overrides for one module: 'name' is either a class name as the LOG_* macros see it
+         /// ("Foo", "Tpl<T>") or a source file name ("Network.cpp"). A class override wins over a
+         /// file override, both win over setLogLevel().
+         ///
+         void setClassLogLevel(const std::string& name, LogLevel logLevel);
+         void clearClassLogLevel(const std::string& name);
+         void clearClassLogLevels();
+
          /// Enable all log levels (for most detailed logging)
          ///
          void enableAllLog();
@@ -147,12 +720,161 @@ namespace CPlusPlusLogging
          ///
          void disableLog();
 
+         /// Asynchronous mode: records are queued and written by a background thread.
+         /// Switch it on/off before/after the logging threads run, not while they log.
+         ///
+         void enableAsyncLog(size_t capacity = DEFAULT_ASYNC_QUEUE_SIZE, OverflowPolicy policy = OVERFLOW_BLOCK);
+         void disableAsyncLog();
+
+         /// Batched mode: every thread appends lines to its own buffer, the writer thread collects
+         /// the buffers and writes them with writev(). With 'sequenced' each line starts with
+         /// "#<n> ", a process-wide sequence number to rebuild the global order (e.g. sort -n).
+         /// Like the asynchronous mode, switch it on/off while no other thread logs.
+         ///
+         void enableBatchedLog(size_t bufferSize = DEFAULT_BATCH_BUFFER_SIZE, bool sequenced = false);
+         void disableBatchedLog();
+
+         /// How the batched mode writes the log file, see FileBackend and FileWriter. 'direct'
+         /// opens it with O_DIRECT (FILE_BACKEND_PWRITE/URING only), 'syncOnFlush' makes flush()
+         /// and the flush policy also fdatasync the file. Takes effect on the next enableBatchedLog().
+         ///
+         void setFileBackend(FileBackend backend, bool direct = false, bool syncOnFlush = false);
+
+         /// How the writer thread of the asynchronous and batched modes waits for work, see
+         /// WriterBackoff. 'sleepUs' is the pass interval of BACKOFF_SLEEP.
+         ///
+         void setWriterBackoff(WriterBackoff backoff, unsigned sleepUs = DEFAULT_WRITER_SLEEP_US);
+
+         /// Pins the background threads of this logger (writer, sinks, settings and stats) to
+         /// 'cpus', e.g. to keep them off the cores of latency critical threads. Running threads
+         /// move right away, later ones start pinned; an empty list lifts the pinning.
+         /// setBackendNode() pins to the CPUs of one NUMA node. One named logger per node, each
+         /// pinned to its node and with a file of its own, gives node-local writers:
+         ///
+         ///     Logger::get("node1", "app.node1.log")->setBackendNode(1);
+         ///     LOG_INFO_TO(perNode[CpuAffinity::currentNode()], ...);
+         ///
+         bool setBackendAffinity(const std::vector<int>& cpus);
+         bool setBackendNode(int node);
+
+         /// File flush policy: the log file is flushed once 'bytes' are pending, once 'intervalMs'
+         /// have passed since the last flush, or right away for records at 'immediateLevel' or more
+         /// severe. In synchronous mode the interval is checked whenever a record is written, the
+         /// asynchronous writer checks it on every wake up.
+         ///
+         void setFlushPolicy(size_t bytes = DEFAULT_FLUSH_BYTES,
+                             unsigned intervalMs = DEFAULT_FLUSH_INTERVAL_MS,
+                             LOG_LEVEL immediateLevel = DEFAULT_FLUSH_LEVEL);
+
+         /// Record timestamps are "YYYY-MM-DD HH:MM:SS", optionally followed by
+         /// milliseconds or microseconds
+         ///
+         void setTimestampPrecision(TimestampPrecision precision);
+
+         /// Log rotation: the log file is renamed to "<log file>.<YYYYmmdd-HHMMSS.mmm>" (UTC) once it
+         /// holds 'maxBytes', and at every multiple of 'intervalSec' seconds of wall-clock time
+         /// (3600 rotates on the hour). A 0 switches that trigger off. Rotated files are compressed
+         /// on a background thread and only the newest 'keep' are kept (0 keeps all of them).
+         /// Logging continues into a fresh file right away. The memory-mapped sink and the
+         /// binary log file are not rotated.
+         ///
+         void setRotationPolicy(size_t maxBytes, unsigned intervalSec,
+                                unsigned keep = DEFAULT_ROTATION_KEEP,
+                                LogCompression compression = COMPRESS_GZIP);
+
+         /// Blocks until every record logged so far has been written and flushed
+         ///
+         void flush();
+
+         /// Number of records discarded by the drop-newest/drop-oldest overflow policies
+         ///
+         uint64_t getDroppedCount() const;
+
+         /// Selects text, deferred or binary records for the asynchronous mode. Has no effect
+         /// on synchronous logging, which always formats on the caller's thread.
+         ///
+         void setLogEncoding(LogEncoding encoding);
+
+         /// Selects plain text, JSON lines or logfmt records. Structured records carry the time,
+         /// level, class, function and thread id as fields and the arguments as typed values
+         /// ("args":[...] or arg0=... arg1=...). The deferred and binary encodings keep
+         /// the text layout.
+         ///
+         void setLogFormat(LogFormat logFormat);
+
+         /// Additional sinks. Every record within the logger level and the sink's 'level' is
+         /// formatted once, into a reference counted LogLine, and queued for each sink. Every sink
+         /// has its own queue and thread, so a slow one never holds up the others or the caller:
+         /// with the default drop-newest policy a full queue drops (and counts) the record. The
+         /// LOG_TYPE output keeps working next to them. Sinks stay owned by the caller and must
+         /// outlive removeSink(), which writes out what is queued for the sink first.
+         ///
+         bool addSink(LogSink* sink, LOG_LEVEL level = LOG_LEVEL_ALL,
+                      size_t capacity = DEFAULT_SINK_QUEUE_SIZE,
+                      OverflowPolicy policy = OVERFLOW_DROP_NEWEST);
+         void removeSink(LogSink* sink);
+         void setSinkLogLevel(LogSink* sink, LOG_LEVEL level);
+         uint64_t getSinkDroppedCount(LogSink* sink);
+
+         /// Flight recorder: records from 'level' up to TRACE (the logger level still has to let
+         /// them through) are not written anywhere but appended to a per-thread in-memory ring
+         /// of 'ringSize' bytes that overwrites its oldest lines. The rings go to the log file
+         /// when a FATAL record is logged, on dumpFlightRecorder(), and with 'onCrash' from the
+         /// crash handler (see installCrashHandler()). Every dump writes only what was recorded
+         /// since the last one.
+         ///
+         void enableFlightRecorder(LOG_LEVEL level = LOG_LEVEL_DEBUG,
+                                   size_t ringSize = DEFAULT_FLIGHT_RING_SIZE,
+                                   bool onCrash = true);
+         void disableFlightRecorder();
+         void dumpFlightRecorder();
+
+         /// Crash handler for SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT and SIGTERM. Using only
+         /// write(2) on a descriptor opened here, it writes out what is still in memory: the
+         /// m_File stream buffer, the asynchronous queue, the batched buffers and the flight
+         /// recorder rings, followed by a backtrace. Then the action the application had for the
+         /// signal is restored and the signal raised again: the default action ends the process,
+         /// a handler of the application's runs, and if it returns, logging resumes. Signals
+         /// the application ignores are left alone. Records of the sinks, deferred and binary
+         /// records are not recovered. The handler runs on an alternate stack, so a stack
+         /// overflow of the calling thread is caught too.
+         ///
+         void installCrashHandler();
+
+         /// Self-instrumentation: every thread counts its records per level, the bytes and flushes
+         /// it hands to the outputs, its drops and waits at full queues, and keeps histograms
+         /// of how long its log calls take to hand a record over and how long the writes take.
+         /// The counters are per thread and written without locked instructions, the queue
+         /// high-water marks are only touched when they grow. stats() sums them up. With a
+         /// 'reportIntervalMs' a background thread also logs the snapshot as an INFO record, or
+         /// rewrites 'path' with it in the Prometheus text format. Counting stops while disabled,
+         /// the totals are kept.
+         ///
+         void enableStats(unsigned reportIntervalMs = 0, StatsReport report = STATS_REPORT_LOG,
+                          const std::string& path = "");
+         void disableStats();
+         LogStats stats() const;
+
+         /// Chrome trace export: every LOG_SCOPE/LOG_TIMED span that passes the level checks is
+         /// also written to 'path' as a complete trace event, for chrome://tracing or Perfetto.
+         /// Without 'logSpans' the spans only go to the trace file. flush() writes the pending
+         /// events, disableTraceExport() completes the file.
+         ///
+         bool enableTraceExport(const std::string& path, bool logSpans = true);
+         void disableTraceExport();
+
+         /// Watches the settings file (inotify, plus an mtime check every 'intervalMs') on a
+         /// background thread. Whenever it changes, its "logging_level" is applied with setLogLevel().
+         ///
+         void enableConfigReload(unsigned intervalMs = DEFAULT_CONFIG_POLL_MS);
+         void disableConfigReload();
+
          void mylog (int level, std::string s) {
              std::cout << "msg: " << s << std::endl;
          }
 
          void mylog_r (int level, format &fmt) {
-             std::cout << "fmt: " << fmt.oss_.str() << std::endl;
+             std::cout << "fmt: " << fmt.view() << std::endl;
          }
 
          template <typename T, typename... Params>
@@ -167,6 +889,7 @@ namespace CPlusPlusLogging
 
       protected:
          Logger();
+         Logger(const std::string& name, const std::string& fileName, size_t index);
          ~Logger();
 
          /// Wrapper function for lock/unlock
@@ -176,24 +899,319 @@ namespace CPlusPlusLogging
          void unlock();
 
       private:
-         void log_direct(std::string data) throw();
-         void log_direct_buffer(const char* text) throw();
-         void logIntoFile(std::string& data);
-         void logOnConsole(std::string& data);
-         static std::string getLogTypeTag(LOG_LEVEL level);
+         void log_direct(LOG_LEVEL level, std::string_view data) throw();
+         void log_direct_buffer(std::string_view text, LOG_LEVEL level = LOG_LEVEL_BUFFER) throw();
+         void log_message(const LogSite* site, std::string_view text) throw();
+         void beginStructured(format& record, const LogSite* site, LogFormat logFormat);
+         void logIntoFile(LOG_LEVEL level, std::string_view data);
+         void logOnConsole(LOG_LEVEL level, std::string_view data);
+         void logIntoMappedFile(std::string_view timestamp, std::string_view data);
+         bool fileFlushDue(bool urgent, uint64_t now) const;
+         static Logger* createInstance();
+         static void publish(Logger* logger);
+         static void flushAtExit();
+
+         /// Acquire pairs with setLogType(), so a sink it opened is ready when its type is seen
+         LogType logType() const { return m_LogType.load(std::memory_order_acquire); }
+         void flushFile(uint64_t now);
+         LOG_LEVEL resolveLevel(const LogSite& site);
+         static bool readConfigLevel(LOG_LEVEL& level);
+         bool reloadConfig();
+         static void* configThread(void* arg);
+         bool toFlightRecorder(LOG_LEVEL level, std::string_view data, bool stamped);
+         bool openDumpFile();
+         static void installCrashAction(int sig);
+         static void crashSignal(int sig);
+         bool writePending(int sig);
+         void resumeAfterSignal(bool locked);
+         void parkIfCrashing();
+
+         /// The calling thread's counters, NULL while stats are off
+         ThreadStats* threadStats()
+         {
+             return LOG_UNLIKELY(m_StatsEnabled.load(std::memory_order_relaxed)) ? acquireStats() : NULL;
+         }
+         ThreadStats* acquireStats();
+         static void noteHighWater(std::atomic<uint64_t>& highWater, uint64_t depth);
+         void countBytes(size_t bytes);
+         void reportStats();
+         static void* statsThread(void* arg);
+         void rotateIfDue();
+         void rotateFile();
+         std::string archiveName();
+         static const char* getLogTypeTag(LOG_LEVEL level);
+
+         /// A pre-formatted record travelling through the asynchronous queue
+         struct LogRecord
+         {
+             LogType     type;
+             LOG_LEVEL   level;
+             bool        binary;        // text holds a BinaryEncoder entry instead of a text line
+             std::string text;
+         };
+
+         /// Only copies the call site key, a timestamp and the raw arguments
+         template <typename... Params>
+         void binary_log(const LogSite* site, const Params&... parameters)
+         {
+             const LogType type = logType();
+             if (type == NO_LOG)
+                 return;
+
+             format entry;
+             BinaryEncoder::beginEntry(entry, site, BinaryEncoder::now());
+             (BinaryEncoder::encodeArg(entry, parameters), ...);
+             enqueue(type, site->level, std::string_view(), entry.view(), true);
+         }
+
+         /// JSON lines / logfmt record. The site's fields come pre-escaped, only the
+         /// timestamp and the arguments are encoded per call.
+         template <typename... Params>
+         void structured_log(const LogSite* site, const Params&... parameters)
+         {
+             const LogFormat logFormat = m_Format.load(std::memory_order_relaxed);
+
+             format record;
+             beginStructured(record, site, logFormat);
+             if (logFormat == FORMAT_JSON)
+             {
+                 record.append(",\"args\":[", 9);
+                 size_t index = 0;
+                 ((record.append(",", index++ ? 1 : 0), StructuredFormat::jsonValue(record, parameters)), ...);
+                 record.append("]}", 2);
+             }
+             else
+             {
+                 size_t index = 0;
+                 ((record.append(" arg", 4), record.write(index++), record.append('='),
+                   StructuredFormat::logfmtValue(record, parameters)), ...);
+             }
+             log_direct_buffer(record.view(), site->level);
+         }
+
+         void enqueue(LogType type, LOG_LEVEL level, std::string_view timestamp, std::string_view text, bool binary = false);
+
+         /// Queue and thread of one sink added with addSink()
+         struct SinkQueue
+         {
+             LogSink*                sink;
+             std::atomic<LOG_LEVEL>  level;
+             OverflowPolicy          policy;
+             RingBuffer<LogLine*>    queue;
+             std::atomic<uint64_t>   dropped;
+             std::atomic<bool>       running;
+             std::atomic<uint64_t>   flushRequest;
+             std::atomic<uint64_t>   flushAck;
+             pthread_t               thread;
+             pthread_mutex_t         wakeMutex;
+             pthread_cond_t          wakeCond;
+
+             SinkQueue(LogSink* s, LOG_LEVEL l, size_t capacity, OverflowPolicy p);
+             ~SinkQueue();
+         };
+
+         void fanOut(LOG_LEVEL level, std::string_view timestamp, std::string_view text);
+         void pushToSink(SinkQueue* sink, LogLine* line);
+         SinkQueue* findSink(LogSink* sink);
+         void flushSinks();
+         static void drainSink(SinkQueue* sink);
+         static void* sinkThread(void* arg);
+         void writeBinaryRecord(const LogRecord& record);
+         void writeDeferredRecord(const LogRecord& record);
+         void writeRecord(const LogRecord& record);
+
+         void appendToBatch(LogType type, LOG_LEVEL level, std::string_view timestamp, std::string_view text);
+         ThreadBuffer* threadBuffer();
+         void handOver(ThreadBuffer* buffer);
+         void drainBatches();
+         void writeBatches(std::vector<LogBatch*>& batches);
+
+         bool startWriter();
+         void stopWriter();
+         void waitForWork();
+         void wakeWriter();
+         void waitForSpace();
+         void pinBackend(pthread_t thread);
+         void drainQueue();
+         static void* writerThread(void* arg);
 
          Logger(const Logger& obj) {}
          void operator=(const Logger& obj) {}
 
       private:
          static Logger*          m_Instance;
+         std::string             m_Name;
+         std::string             m_FileName;
+         size_t                  m_Index;            // slot in the logger registry and the per-thread caches
          std::ofstream           m_File;
+         char*                   m_FileBuffer;
+         MappedFile              m_MappedFile;
+
+         // File flush policy. The settings can change at any time and are read without m_Mutex,
+         // hence atomic. The counters belong to whoever writes m_File: callers holding m_Mutex
+         // in synchronous mode, the writer thread in asynchronous mode.
+         std::atomic<size_t>     m_FlushBytes;
+         std::atomic<uint64_t>   m_FlushIntervalMs;
+         std::atomic<LOG_LEVEL>  m_FlushLevel;
+         size_t                  m_PendingBytes;
+         bool                    m_UrgentPending;
+         uint64_t                m_LastFlushMs;
+
+         // Cached settings file, the stamp is compared by the config thread only
+         std::atomic<LogLevel>   m_ConfigLevel;
+         std::atomic<bool>       m_ConfigLoaded;
+         pthread_mutex_t         m_ConfigMutex;
+         struct timespec         m_ConfigStamp;
+         off_t                   m_ConfigSize;
+         ino_t                   m_ConfigInode;
+         unsigned                m_ConfigPollMs;
+         std::atomic<bool>       m_ConfigRunning;
+         int                     m_ConfigWakeFd;
+         pthread_t               m_ConfigThread;
+
+         // Log rotation, guarded by m_Mutex. m_FileBytes is counted like m_PendingBytes.
+         size_t                  m_RotateBytes;
+         unsigned                m_RotateIntervalSec;
+         uint64_t                m_RotateAt;
+         uint64_t                m_FileBytes;
+         uint64_t                m_LastArchiveMs;
+         LogArchiver             m_Archiver;
 
          pthread_mutexattr_t     m_Attr;
          pthread_mutex_t         m_Mutex;
 
-         LogLevel                m_LogLevel;
-         LogType                 m_LogType;
+         std::atomic<LogLevel>   m_LogLevel;
+
+         // Per-class/per-file levels. Changes bump m_LevelGeneration, which invalidates every
+         // call site's cached level.
+         std::unordered_map<std::string, LogLevel> m_LevelOverrides;      // guarded by m_OverrideMutex
+         pthread_mutex_t         m_OverrideMutex;
+         std::atomic<uint64_t>   m_LevelGeneration;
+         TimestampCache          m_Timestamp;
+         std::atomic<LogType>    m_LogType;
+         std::atomic<LogFormat>  m_Format;
+
+         // Asynchronous backend
+         RingBuffer<LogRecord>*  m_Queue;
+         OverflowPolicy          m_OverflowPolicy;
+         std::atomic<bool>       m_AsyncEnabled;
+         std::atomic<bool>       m_WriterRunning;
+         std::atomic<uint64_t>   m_Dropped;
+         std::atomic<uint64_t>   m_FlushRequest;
+         std::atomic<uint64_t>   m_FlushAck;
+         pthread_t               m_Writer;
+         pthread_mutex_t         m_WakeMutex;
+         pthread_cond_t          m_WakeCond;
+         pthread_cond_t          m_SpaceCond;       // OVERFLOW_BLOCK producers, with m_WakeMutex
+         std::atomic<unsigned>   m_SpaceWaiters;
+
+         // Deferred/binary encoding
+         std::atomic<LogEncoding>            m_Encoding;
+         std::ofstream                       m_BinaryFile;
+         std::unordered_set<const void*>     m_KnownSites;  // sites already described in m_BinaryFile
+
+         // Batched per-thread buffers, m_BatchMutex guards the three lists
+         std::atomic<bool>                   m_BatchEnabled;
+         std::atomic<bool>                   m_BatchUrgent;     // an urgent line was handed over
+         size_t                              m_BatchSize;
+         bool                                m_BatchSequenced;
+         std::atomic<uint64_t>               m_Sequence;
+         int                                 m_BatchFd;
+         pthread_mutex_t                     m_BatchMutex;
+         std::vector<ThreadBuffer*>          m_ThreadBuffers;
+         std::vector<LogBatch*>              m_FullBatches;
+         std::vector<LogBatch*>              m_SpareBatches;
+
+         // Buffered/io_uring file writer of the batched mode, see setFileBackend()
+         FileBackend                         m_FileBackend;
+         bool                                m_FileDirect;
+         bool                                m_FileSync;
+         FileWriter                          m_BatchWriter;     // writer thread only while batched
+
+         // Sink fan-out. Slots are filled and cleared under m_SinkMutex, producers only load
+         // them. Removed queues are parked until the destructor, a producer may still hold one.
+         std::atomic<SinkQueue*>             m_Sinks[MAX_LOG_SINKS];
+         std::atomic<size_t>                 m_SinkCount;        // slots in use, from the front
+         pthread_mutex_t                     m_SinkMutex;
+         std::vector<SinkQueue*>             m_RetiredSinks;
+
+         // Flight recorder and crash handler. m_DumpFd appends to the log file and is opened up
+         // front, so a signal handler gets by with write(2).
+         FlightRecorder                      m_FlightRecorder;
+         std::atomic<bool>                   m_FlightEnabled;
+         std::atomic<LOG_LEVEL>              m_FlightLevel;
+         int                                 m_DumpFd;
+         std::atomic<bool>                   m_Crashing;
+         std::atomic<int>                    m_Parked;           // writers stopped by the crash handler
+
+         // Self-instrumentation, the report settings are read by the stats thread only
+         StatsRegistry                       m_Stats;
+         std::atomic<bool>                   m_StatsEnabled;
+         std::atomic<uint64_t>               m_QueueDepth;       // sampled by the writer thread
+         std::atomic<uint64_t>               m_QueueHighWater;
+         std::atomic<uint64_t>               m_SinkHighWater;
+         StatsReport                         m_StatsReport;
+         std::string                         m_StatsPath;
+         unsigned                            m_StatsIntervalMs;
+         std::atomic<bool>                   m_StatsRunning;
+         int                                 m_StatsWakeFd;
+         pthread_t                           m_StatsThread;
+
+         // Span export, see enableTraceExport()
+         TraceExport                         m_Trace;
+         std::atomic<bool>                   m_TraceEnabled;
+         std::atomic<bool>                   m_TraceLogSpans;
+
+         // CONSOLE output, see setConsoleColor()
+         ConsoleOutput                       m_Console;
+
+         // Background thread placement and the writer's wait, see setBackendAffinity()
+         std::vector<int>                    m_BackendCpus;     // guarded by m_AffinityMutex
+         pthread_mutex_t                     m_AffinityMutex;
+         std::atomic<WriterBackoff>          m_Backoff;
+         std::atomic<unsigned>               m_BackoffSleepUs;
+         std::atomic<bool>                   m_WriterIdle;      // BACKOFF_BLOCK writer about to wait
+    };
+
+    ///
+    /// The RAII span behind LOG_SCOPE/LOG_TIMED. Only a scope that is enabled on entry reads
+    /// the clock and is logged on exit.
+    ///
+    template <bool Compiled>
+    class LogScope
+    {
+      public:
+         /// A NULL logger is getInstance()
+         LogScope(Logger* logger, const LogSite* site, std::string_view name)
+            : m_Logger(logger ? logger : Logger::getInstance()), m_Site(site), m_Name(name), m_Start(0)
+         {
+             if (LOG_UNLIKELY(m_Logger->isEnabled(*site)))
+                 m_Start = LatencyHistogram::nowNs();
+         }
+
+         ~LogScope()
+         {
+             if (LOG_UNLIKELY(m_Start != 0))
+                 m_Logger->log_span(m_Site, m_Name, m_Start, LatencyHistogram::nowNs() - m_Start);
+         }
+
+      private:
+         LogScope(const LogScope& obj);
+         void operator=(const LogScope& obj);
+
+      private:
+         Logger*             m_Logger;
+         const LogSite*      m_Site;
+         std::string_view    m_Name;
+         uint64_t            m_Start;
+    };
+
+    /// Scopes above LOG_COMPILE_LEVEL
+    template <>
+    class LogScope<false>
+    {
+      public:
+         constexpr LogScope(Logger*, const LogSite*, std::string_view) { }
     };
 
 } // End of namespace
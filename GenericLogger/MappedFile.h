@@ -0,0 +1,241 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace CPlusPlusLogging
+{
+    // Size of every mapped (and pre-allocated) extent of the log file
+    #define DEFAULT_MMAP_SEGMENT_SIZE   (64 * 1024 * 1024)
+
+    ///
+    /// Append-only log file written through MAP_SHARED mappings. Writers reserve their bytes
+    /// with one atomic add on the tail offset and copy straight into the page cache, no syscall
+    /// and no lock. When the reservation runs past the mapped extent, the next extent is
+    /// pre-allocated with posix_fallocate() and mapped under a mutex (the only slow path).
+    /// Extents stay mapped until close(), so a writer still copying into an older one is safe.
+    ///
+    /// Dirty pages belong to the kernel, so everything copied survives a process crash. The file
+    /// is truncated to its real length on close(); after a crash the zero filled pre-allocated
+    /// tail is skipped by the next open().
+    ///
+    class MappedFile
+    {
+      public:
+         MappedFile() : m_Fd(-1), m_SegmentSize(0)
+         {
+             m_Tail.store(0);
+             m_Current.store(NULL);
+             pthread_mutex_init(&m_Lock, NULL);
+         }
+
+         ~MappedFile()
+         {
+             close();
+             pthread_mutex_destroy(&m_Lock);
+         }
+
+         bool isOpen() const { return m_Fd >= 0; }
+
+         ///
+         /// Opens (or creates) the file, new records go after its current content
+         ///
+         bool open(const std::string& path, size_t segmentSize = DEFAULT_MMAP_SEGMENT_SIZE)
+         {
+             close();
+
+             int fd = ::open(path.c_str(), O_RDWR|O_CREAT, 0644);
+             if (fd < 0)
+                 return false;
+
+             struct stat st;
+             if (fstat(fd, &st) != 0)
+             {
+                 ::close(fd);
+                 return false;
+             }
+
+             const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+             m_SegmentSize = (segmentSize + page - 1) / page * page;
+             m_Fd = fd;
+             m_Tail.store(findEnd(fd, (uint64_t)st.st_size));
+
+             pthread_mutex_lock(&m_Lock);
+             const bool mapped = mapSegment(m_Tail.load() / page * page);
+             pthread_mutex_unlock(&m_Lock);
+             if (!mapped)
+             {
+                 close();
+                 return false;
+             }
+             return true;
+         }
+
+         ///
+         /// Appends one record. Safe to call from any number of threads.
+         ///
+         void write(const char* data, size_t length)
+         {
+             const uint64_t offset  = m_Tail.fetch_add(length, std::memory_order_relaxed);
+             Segment*       segment = m_Current.load(std::memory_order_acquire);
+             if (segment && offset >= segment->start && offset + length <= segment->end)
+             {
+                 memcpy(segment->base + (offset - segment->start), data, length);
+                 return;
+             }
+             writeSlow(offset, data, length);
+         }
+
+         ///
+         /// Starts write back of the dirty pages, optionally waiting for it
+         ///
+         void sync(bool wait)
+         {
+             pthread_mutex_lock(&m_Lock);
+             for (size_t i = 0; i < m_Segments.size(); ++i)
+                 msync(m_Segments[i]->base, m_Segments[i]->end - m_Segments[i]->start, wait ? MS_SYNC : MS_ASYNC);
+             pthread_mutex_unlock(&m_Lock);
+         }
+
+         ///
+         /// Unmaps everything and cuts the pre-allocated space off. No thread may write meanwhile.
+         ///
+         void close()
+         {
+             if (m_Fd < 0)
+                 return;
+
+             pthread_mutex_lock(&m_Lock);
+             m_Current.store(NULL);
+             for (size_t i = 0; i < m_Segments.size(); ++i)
+             {
+                 munmap(m_Segments[i]->base, m_Segments[i]->end - m_Segments[i]->start);
+                 delete m_Segments[i];
+             }
+             m_Segments.clear();
+
+             if (ftruncate(m_Fd, (off_t)m_Tail.load()) != 0)
+             {
+                 // The zero filled tail stays, the next open() skips it
+             }
+             ::close(m_Fd);
+             m_Fd = -1;
+             pthread_mutex_unlock(&m_Lock);
+         }
+
+      private:
+         struct Segment
+         {
+             char*      base;
+             uint64_t   start;      // file offset of base
+             uint64_t   end;
+         };
+
+         ///
+         /// Pre-allocates and maps the next extent. Called with m_Lock held.
+         ///
+         bool mapSegment(uint64_t start)
+         {
+             const uint64_t end = start + m_SegmentSize;
+             if (posix_fallocate(m_Fd, (off_t)start, (off_t)m_SegmentSize) != 0)
+             {
+                 // File systems without fallocate support still allow a sparse extension
+                 struct stat st;
+                 if (fstat(m_Fd, &st) != 0 || ((uint64_t)st.st_size < end && ftruncate(m_Fd, (off_t)end) != 0))
+                     return false;
+             }
+
+             void* base = mmap(NULL, m_SegmentSize, PROT_READ|PROT_WRITE, MAP_SHARED, m_Fd, (off_t)start);
+             if (base == MAP_FAILED)
+                 return false;
+
+             Segment* segment = new Segment();
+             segment->base  = (char*)base;
+             segment->start = start;
+             segment->end   = end;
+             m_Segments.push_back(segment);
+             m_Current.store(segment, std::memory_order_release);
+             return true;
+         }
+
+         ///
+         /// Reservation outside the current extent: map what is missing and copy piecewise
+         ///
+         void writeSlow(uint64_t offset, const char* data, size_t length)
+         {
+             pthread_mutex_lock(&m_Lock);
+             while (!m_Segments.empty() && m_Segments.back()->end < offset + length)
+             {
+                 if (!mapSegment(m_Segments.back()->end))
+                 {
+                     // Out of space: the record is lost, later ones may still fit after a cleanup
+                     pthread_mutex_unlock(&m_Lock);
+                     return;
+                 }
+             }
+
+             for (size_t i = m_Segments.size(); i > 0; --i)
+             {
+                 Segment* segment = m_Segments[i - 1];
+                 if (segment->end <= offset)
+                     break;
+
+                 const uint64_t from = (offset > segment->start) ? offset : segment->start;
+                 const uint64_t to   = (offset + length < segment->end) ? offset + length : segment->end;
+                 if (from < to)
+                     memcpy(segment->base + (from - segment->start), data + (from - offset), to - from);
+             }
+             pthread_mutex_unlock(&m_Lock);
+         }
+
+         ///
+         /// Real end of a file that may still carry a zero filled tail from a crashed run
+         ///
+         static uint64_t findEnd(int fd, uint64_t size)
+         {
+             char chunk[4096];
+             while (size > 0)
+             {
+                 const size_t  length = (size < sizeof(chunk)) ? (size_t)size : sizeof(chunk);
+                 const ssize_t got    = pread(fd, chunk, length, (off_t)(size - length));
+                 if (got != (ssize_t)length)
+                     return size;
+
+                 for (size_t i = length; i > 0; --i)
+                 {
+                     if (chunk[i - 1] != '\0')
+                         return size - length + i;
+                 }
+                 size -= length;
+             }
+             return 0;
+         }
+
+         MappedFile(const MappedFile& obj);
+         void operator=(const MappedFile& obj);
+
+      private:
+         int                     m_Fd;
+         size_t                  m_SegmentSize;
+         std::atomic<uint64_t>   m_Tail;
+         std::atomic<Segment*>   m_Current;
+         std::vector<Segment*>   m_Segments;     // guarded by m_Lock
+         pthread_mutex_t         m_Lock;
+    };
+
+} // End of namespace
+
+#endif // End of _MAPPED_FILE_H_
@@ -0,0 +1,373 @@
+#ifndef _NETWORK_SINK_H_
+#define _NETWORK_SINK_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Code Specific Header Files(s)
+#include "LogSink.h"
+
+namespace CPlusPlusLogging
+{
+    // enum for the transport of the network sink
+    typedef enum NETWORK_PROTOCOL
+    {
+      NET_UDP           = 1,        // Records packed into datagrams, newline separated.
+      NET_TCP           = 2,        // Octet counted frames ("<length> <record>", RFC 6587).
+    } NetworkProtocol;
+
+    // Defaults of the network sink
+    #define DEFAULT_NETWORK_DATAGRAM_SIZE   8192                // bytes per UDP datagram
+    #define DEFAULT_NETWORK_SPILL_SIZE      (4 * 1024 * 1024)   // bytes held while the collector is away
+    #define NETWORK_RECONNECT_MIN_MS        100
+    #define NETWORK_RECONNECT_MAX_MS        5000
+    #define NETWORK_SEND_BATCH              64                  // datagrams per sendmmsg()
+
+    ///
+    /// Ships records to a central collector. Whatever arrives is appended to a bounded spill
+    /// buffer and sent with non-blocking calls from the sink thread: UDP packs as many records
+    /// as fit into each datagram and sends up to NETWORK_SEND_BATCH datagrams per sendmmsg(),
+    /// TCP writes framed records in as few send() calls as the socket accepts.
+    ///
+    /// A lost connection is re-established from idle() with an exponential backoff, the spill
+    /// buffer keeps the records meanwhile. Once it is full, new records are dropped and counted
+    /// (getDroppedCount()). The producers never see any of this, they only queue a reference.
+    ///
+    class NetworkSink : public LogSink
+    {
+      public:
+         NetworkSink(const std::string& host, const std::string& port, NetworkProtocol protocol = NET_UDP,
+                     size_t spillSize = DEFAULT_NETWORK_SPILL_SIZE,
+                     size_t datagramSize = DEFAULT_NETWORK_DATAGRAM_SIZE)
+           : m_Host(host), m_Port(port), m_Protocol(protocol), m_SpillSize(spillSize),
+             m_DatagramSize(datagramSize ? datagramSize : DEFAULT_NETWORK_DATAGRAM_SIZE),
+             m_Fd(-1), m_Connecting(false), m_Sent(0), m_FrameStart(0), m_RetryAt(0), m_Backoff(NETWORK_RECONNECT_MIN_MS)
+         {
+             m_Dropped.store(0);
+             m_Connected.store(false);
+         }
+
+         virtual ~NetworkSink()
+         {
+             disconnect();
+         }
+
+         /// Records dropped because the spill buffer was full
+         uint64_t getDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+         bool isConnected() const { return m_Connected.load(std::memory_order_relaxed); }
+
+         virtual void write(const LogLine& line)
+         {
+             const std::string_view text = line.text();
+
+             char   frame[24];
+             size_t frameLength = 0;
+             if (m_Protocol == NET_TCP)
+                 frameLength = (size_t)snprintf(frame, sizeof(frame), "%zu ", text.size() + 1);
+
+             if (m_Spill.size() - m_Sent + frameLength + text.size() + 1 > m_SpillSize)
+             {
+                 m_Dropped.fetch_add(1, std::memory_order_relaxed);
+                 return;
+             }
+
+             compact();
+             m_Spill.append(frame, frameLength);
+             m_Spill.append(text.data(), text.size());
+             m_Spill.append(1, '\n');
+
+             // Keep the buffer from growing past a few datagrams while connected
+             if (m_Spill.size() - m_Sent >= NETWORK_SEND_BATCH * m_DatagramSize)
+                 flush();
+         }
+
+         virtual void flush()
+         {
+             if (!ready())
+                 return;
+
+             if (m_Protocol == NET_UDP)
+                 sendDatagrams();
+             else
+                 sendStream();
+             compact();
+         }
+
+         virtual void idle()
+         {
+             if (m_Sent < m_Spill.size() || m_Fd < 0 || m_Connecting)
+                 flush();
+         }
+
+      private:
+         /// True once the socket can take data, (re)connecting when the backoff allows it
+         bool ready()
+         {
+             if (m_Fd >= 0 && !m_Connecting)
+                 return true;
+
+             const uint64_t now = nowMs();
+             if (m_Fd < 0)
+             {
+                 if (now < m_RetryAt)
+                     return false;
+                 connect(now);
+                 if (m_Fd < 0)
+                     return false;
+             }
+
+             if (m_Connecting)
+             {
+                 // Non-blocking TCP connect in progress
+                 struct pollfd pfd;
+                 pfd.fd     = m_Fd;
+                 pfd.events = POLLOUT;
+                 if (poll(&pfd, 1, 0) <= 0)
+                     return false;
+
+                 int       error  = 0;
+                 socklen_t length = sizeof(error);
+                 if (getsockopt(m_Fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0)
+                 {
+                     failed(now);
+                     return false;
+                 }
+                 m_Connecting = false;
+             }
+
+             m_Connected.store(true, std::memory_order_relaxed);
+             return true;
+         }
+
+         void connect(uint64_t now)
+         {
+             struct addrinfo hints;
+             memset(&hints, 0, sizeof(hints));
+             hints.ai_family   = AF_UNSPEC;
+             hints.ai_socktype = (m_Protocol == NET_UDP) ? SOCK_DGRAM : SOCK_STREAM;
+
+             struct addrinfo* found = NULL;
+             if (getaddrinfo(m_Host.c_str(), m_Port.c_str(), &hints, &found) != 0 || found == NULL)
+             {
+                 failed(now);
+                 return;
+             }
+
+             m_Fd = socket(found->ai_family, found->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+             if (m_Fd >= 0)
+             {
+                 if (m_Protocol == NET_TCP)
+                 {
+                     int one = 1;
+                     setsockopt(m_Fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                 }
+
+                 // A connected UDP socket also reports an unreachable collector (ECONNREFUSED)
+                 if (::connect(m_Fd, found->ai_addr, found->ai_addrlen) == 0)
+                     m_Connecting = false;
+                 else if (errno == EINPROGRESS)
+                     m_Connecting = true;
+                 else
+                     failed(now);
+             }
+             else
+             {
+                 failed(now);
+             }
+             freeaddrinfo(found);
+         }
+
+         /// Drops the socket and schedules the next attempt, the spill buffer is kept
+         void failed(uint64_t now)
+         {
+             disconnect();
+             m_RetryAt = now + m_Backoff;
+             m_Backoff = (m_Backoff * 2 < NETWORK_RECONNECT_MAX_MS) ? m_Backoff * 2 : NETWORK_RECONNECT_MAX_MS;
+         }
+
+         void disconnect()
+         {
+             if (m_Fd >= 0)
+                 ::close(m_Fd);
+             m_Fd         = -1;
+             m_Connecting = false;
+             m_Connected.store(false, std::memory_order_relaxed);
+         }
+
+         ///
+         /// Cuts the pending bytes into datagrams at record boundaries, a record longer than a
+         /// datagram is split
+         ///
+         void sendDatagrams()
+         {
+             while (m_Sent < m_Spill.size())
+             {
+                 struct iovec  iov[NETWORK_SEND_BATCH];
+                 size_t        count  = 0;
+                 size_t        offset = m_Sent;
+                 while (count < NETWORK_SEND_BATCH && offset < m_Spill.size())
+                 {
+                     size_t length = m_Spill.size() - offset;
+                     if (length > m_DatagramSize)
+                     {
+                         const size_t cut = m_Spill.rfind('\n', offset + m_DatagramSize - 1);
+                         length = (cut != std::string::npos && cut >= offset) ? cut + 1 - offset : m_DatagramSize;
+                     }
+                     iov[count].iov_base = (void*)(m_Spill.data() + offset);
+                     iov[count].iov_len  = length;
+                     offset += length;
+                     ++count;
+                 }
+
+                 const int sent = sendBatch(iov, count);
+                 if (sent <= 0)
+                     return;
+                 m_Backoff = NETWORK_RECONNECT_MIN_MS;
+                 for (int i = 0; i < sent; ++i)
+                     m_Sent += iov[i].iov_len;
+             }
+         }
+
+         /// Datagrams accepted by the socket, 0 when it would block, -1 after a failure
+         int sendBatch(struct iovec* iov, size_t count)
+         {
+#if defined(__linux__)
+             struct mmsghdr messages[NETWORK_SEND_BATCH];
+             memset(messages, 0, sizeof(messages));
+             for (size_t i = 0; i < count; ++i)
+             {
+                 messages[i].msg_hdr.msg_iov    = &iov[i];
+                 messages[i].msg_hdr.msg_iovlen = 1;
+             }
+             const int sent = sendmmsg(m_Fd, messages, (unsigned)count, MSG_DONTWAIT|MSG_NOSIGNAL);
+#else
+             int sent = 0;
+             while ((size_t)sent < count && send(m_Fd, iov[sent].iov_base, iov[sent].iov_len, MSG_DONTWAIT|MSG_NOSIGNAL) >= 0)
+                 ++sent;
+             if (sent == 0)
+                 sent = -1;
+#endif
+             if (sent < 0)
+             {
+                 if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+                     return 0;
+                 failed(nowMs());
+             }
+             return sent;
+         }
+
+         void sendStream()
+         {
+             while (m_Sent < m_Spill.size())
+             {
+                 const ssize_t n = send(m_Fd, m_Spill.data() + m_Sent, m_Spill.size() - m_Sent, MSG_DONTWAIT|MSG_NOSIGNAL);
+                 if (n > 0)
+                 {
+                     m_Sent   += (size_t)n;
+                     m_Backoff = NETWORK_RECONNECT_MIN_MS;
+                     advanceFrames();
+                     continue;
+                 }
+                 if (n < 0 && errno == EINTR)
+                     continue;
+                 if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                     return;
+
+                 // A frame cut by the lost connection is sent again in full on the next one
+                 failed(nowMs());
+                 m_Sent = m_FrameStart;
+                 return;
+             }
+         }
+
+         ///
+         /// Moves m_FrameStart over the TCP frames that are out in full. It always points at a
+         /// frame's octet count, so the buffer is never parsed from the middle of a record.
+         ///
+         void advanceFrames()
+         {
+             while (m_FrameStart < m_Sent)
+             {
+                 char*        digitsEnd = NULL;
+                 const size_t length    = (size_t)strtoull(m_Spill.c_str() + m_FrameStart, &digitsEnd, 10);
+                 const size_t next      = (size_t)(digitsEnd - m_Spill.c_str()) + 1 + length;
+                 if (next > m_Sent)
+                     break;
+                 m_FrameStart = next;
+             }
+         }
+
+         ///
+         /// Moves the unsent tail to the front once the sent part dominates the buffer. A TCP
+         /// frame that is partly out stays whole, a lost connection sends it again.
+         ///
+         void compact()
+         {
+             if (m_Sent == m_Spill.size())
+             {
+                 m_Spill.clear();
+                 m_Sent       = 0;
+                 m_FrameStart = 0;
+                 return;
+             }
+
+             const size_t done = (m_Protocol == NET_TCP) ? m_FrameStart : m_Sent;
+             if (done > m_Spill.size() / 2)
+             {
+                 m_Spill.erase(0, done);
+                 m_Sent      -= done;
+                 m_FrameStart = (m_Protocol == NET_TCP) ? m_FrameStart - done : 0;
+             }
+         }
+
+         static uint64_t nowMs()
+         {
+             struct timespec ts;
+             clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+             return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+         }
+
+         NetworkSink(const NetworkSink& obj);
+         void operator=(const NetworkSink& obj);
+
+      private:
+         std::string             m_Host;
+         std::string             m_Port;
+         NetworkProtocol         m_Protocol;
+         size_t                  m_SpillSize;
+         size_t                  m_DatagramSize;
+
+         // Used by the sink thread only
+         int                     m_Fd;
+         bool                    m_Connecting;
+         std::string             m_Spill;        // pending records, m_Sent bytes of them are out
+         size_t                  m_Sent;
+         size_t                  m_FrameStart;   // TCP: start of the frame m_Sent points into
+         uint64_t                m_RetryAt;
+         uint64_t                m_Backoff;
+
+         std::atomic<uint64_t>   m_Dropped;
+         std::atomic<bool>       m_Connected;
+    };
+
+} // End of namespace
+
+#endif // End of _NETWORK_SINK_H_
@@ -0,0 +1,149 @@
+#ifndef _RING_BUFFER_H_
+#define _RING_BUFFER_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// Bounded lock-free queue used by the asynchronous logging backend. Every slot carries its own
+    /// sequence number (D. Vyukov's bounded MPMC design), so any number of producers can push while the
+    /// writer thread pops. Producers may also pop, which is what the drop-oldest overflow policy uses.
+    /// Items are written and read in place, so slots keep their storage (e.g. string capacity) from
+    /// one lap to the next. Capacity is rounded up to the next power of two.
+    ///
+    template <typename T>
+    class RingBuffer
+    {
+      public:
+         explicit RingBuffer(size_t capacity)
+         {
+             size_t size = 2;
+             while (size < capacity)
+                 size <<= 1;
+
+             m_Mask  = size - 1;
+             m_Slots = new Slot[size];
+             for (size_t i = 0; i < size; ++i)
+                 m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+
+             m_EnqueuePos.store(0, std::memory_order_relaxed);
+             m_DequeuePos.store(0, std::memory_order_relaxed);
+         }
+
+         ~RingBuffer()
+         {
+             delete [] m_Slots;
+         }
+
+         ///
+         /// Claims a slot and calls fill(T&) to write the item in place. Returns false if the queue is full.
+         ///
+         template <typename Fill>
+         bool tryPush(Fill fill)
+         {
+             Slot*  slot;
+             size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+             for (;;)
+             {
+                 slot = &m_Slots[pos & m_Mask];
+                 size_t seq = slot->sequence.load(std::memory_order_acquire);
+                 intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                 if (diff == 0)
+                 {
+                     if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                         break;
+                 }
+                 else if (diff < 0)
+                 {
+                     return false;
+                 }
+                 else
+                 {
+                     pos = m_EnqueuePos.load(std::memory_order_relaxed);
+                 }
+             }
+
+             fill(slot->data);
+             slot->sequence.store(pos + 1, std::memory_order_release);
+             return true;
+         }
+
+         ///
+         /// Calls consume(T&) on the oldest item and releases its slot. Returns false if nothing is
+         /// ready to be consumed.
+         ///
+         template <typename Consume>
+         bool tryPop(Consume consume)
+         {
+             Slot*  slot;
+             size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+             for (;;)
+             {
+                 slot = &m_Slots[pos & m_Mask];
+                 size_t seq = slot->sequence.load(std::memory_order_acquire);
+                 intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                 if (diff == 0)
+                 {
+                     if (m_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                         break;
+                 }
+                 else if (diff < 0)
+                 {
+                     return false;
+                 }
+                 else
+                 {
+                     pos = m_DequeuePos.load(std::memory_order_relaxed);
+                 }
+             }
+
+             consume(slot->data);
+             slot->sequence.store(pos + m_Mask + 1, std::memory_order_release);
+             return true;
+         }
+
+         ///
+         /// True once every claimed slot has been consumed. A failed tryPop() alone is not enough, since
+         /// a producer may have claimed a slot and not yet published it.
+         ///
+         bool empty() const
+         {
+             return m_DequeuePos.load(std::memory_order_acquire) ==
+                    m_EnqueuePos.load(std::memory_order_acquire);
+         }
+
+         size_t capacity() const { return m_Mask + 1; }
+
+         /// Claimed and not yet consumed slots, a snapshot that may be stale right away
+         size_t size() const
+         {
+             const size_t dequeued = m_DequeuePos.load(std::memory_order_relaxed);
+             const size_t enqueued = m_EnqueuePos.load(std::memory_order_relaxed);
+             return (enqueued > dequeued) ? enqueued - dequeued : 0;
+         }
+
+      private:
+         struct Slot
+         {
+             std::atomic<size_t> sequence;
+             T                   data;
+         };
+
+         RingBuffer(const RingBuffer& obj);
+         void operator=(const RingBuffer& obj);
+
+      private:
+         // Producer and consumer positions live on separate cache lines.
+         alignas(64) std::atomic<size_t> m_EnqueuePos;
+         alignas(64) std::atomic<size_t> m_DequeuePos;
+         alignas(64) Slot*               m_Slots;
+         size_t                          m_Mask;
+    };
+
+} // End of namespace
+
+#endif // End of _RING_BUFFER_H_
@@ -0,0 +1,89 @@
+#ifndef _SLOT_REGISTRY_H_
+#define _SLOT_REGISTRY_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstddef>
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// Fixed set of per-thread objects handed on from exited threads to new ones, used by the
+    /// record pools, the stats counters and the flight recorder rings. A thread takes a free
+    /// object on first use (its 'Owned' flag) and releases it when it exits. An empty slot is
+    /// filled with compare-and-swap, so acquire() never locks, and objects are never removed,
+    /// so any thread can walk them with forEach() while they are being used.
+    ///
+    template <typename T, size_t SLOTS, std::atomic<bool> T::*Owned = &T::owned>
+    class SlotRegistry
+    {
+      public:
+         SlotRegistry()
+         {
+             for (size_t i = 0; i < SLOTS; ++i)
+                 m_Slots[i].store(NULL);
+         }
+
+         ~SlotRegistry()
+         {
+             for (size_t i = 0; i < SLOTS; ++i)
+                 delete m_Slots[i].load();
+         }
+
+         /// An object left by an exited thread, or a new one. NULL once all SLOTS are owned by live threads.
+         T* acquire()
+         {
+             return acquire([] { return new T(); });
+         }
+
+         /// Same, 'create' makes the new objects
+         template <typename Create>
+         T* acquire(Create create)
+         {
+             for (size_t i = 0; i < SLOTS; ++i)
+             {
+                 T* item = m_Slots[i].load(std::memory_order_acquire);
+                 if (item == NULL)
+                 {
+                     T* fresh = create();
+                     (fresh->*Owned).store(true, std::memory_order_relaxed);
+                     if (m_Slots[i].compare_exchange_strong(item, fresh, std::memory_order_acq_rel))
+                         return fresh;
+                     delete fresh;
+                 }
+
+                 bool owned = false;
+                 if ((item->*Owned).compare_exchange_strong(owned, true, std::memory_order_acquire))
+                     return item;
+             }
+             return NULL;
+         }
+
+         static void release(T* item)
+         {
+             (item->*Owned).store(false, std::memory_order_release);
+         }
+
+         /// Every object created so far, owned or not. Lock free, so usable from a signal handler.
+         template <typename Visit>
+         void forEach(Visit visit) const
+         {
+             for (size_t i = 0; i < SLOTS; ++i)
+             {
+                 T* item = m_Slots[i].load(std::memory_order_acquire);
+                 if (item != NULL)
+                     visit(item);
+             }
+         }
+
+      private:
+         SlotRegistry(const SlotRegistry& obj);
+         void operator=(const SlotRegistry& obj);
+
+      private:
+         std::atomic<T*>     m_Slots[SLOTS];
+    };
+
+} // End of namespace
+
+#endif // End of _SLOT_REGISTRY_H_
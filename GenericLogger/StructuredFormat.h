@@ -0,0 +1,210 @@
+#ifndef _STRUCTURED_FORMAT_H_
+#define _STRUCTURED_FORMAT_H_
+
+// C++ Header File(s)
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// Value encoders of the JSON lines and logfmt output. Numbers and booleans are written bare,
+    /// everything else as an escaped string. Escaping scans 16 bytes at a time (SSE2) and copies
+    /// clean runs with a single append, so ordinary text costs about as much as a memcpy.
+    ///
+    class StructuredFormat
+    {
+      public:
+         /// JSON string body: '"', '\' and control characters are escaped, UTF-8 passes through
+         static void escapeJson(LogFormatter& out, std::string_view text)
+         {
+             const char*  data   = text.data();
+             const size_t length = text.size();
+             size_t       clean  = 0;
+             size_t       pos    = 0;
+
+             while (pos < length)
+             {
+                 pos = scan(data, length, pos, false);
+                 if (pos == length)
+                     break;
+
+                 out.append(data + clean, pos - clean);
+                 const unsigned char c = (unsigned char)data[pos];
+                 switch (c)
+                 {
+                     case '"':  out.append("\\\"", 2); break;
+                     case '\\': out.append("\\\\", 2); break;
+                     case '\n': out.append("\\n", 2);  break;
+                     case '\r': out.append("\\r", 2);  break;
+                     case '\t': out.append("\\t", 2);  break;
+                     default:
+                     {
+                         char escaped[6] = { '\\', 'u', '0', '0', hexDigit(c >> 4), hexDigit(c & 0x0f) };
+                         out.append(escaped, 6);
+                     }
+                 }
+                 clean = ++pos;
+             }
+             out.append(data + clean, length - clean);
+         }
+
+         static void jsonString(LogFormatter& out, std::string_view text)
+         {
+             out.append('"');
+             escapeJson(out, text);
+             out.append('"');
+         }
+
+         /// logfmt values are bare unless they are empty or hold a space, '=', '"' or a control character
+         static void logfmtString(LogFormatter& out, std::string_view text)
+         {
+             if (!text.empty() && scan(text.data(), text.size(), 0, true) == text.size())
+                 out.append(text);
+             else
+                 jsonString(out, text);
+         }
+
+         template <typename T>
+         static void jsonValue(LogFormatter& out, const T& value)
+         {
+             encode(out, value, false);
+         }
+
+         template <typename T>
+         static void logfmtValue(LogFormatter& out, const T& value)
+         {
+             encode(out, value, true);
+         }
+
+      private:
+         template <typename T>
+         static void encode(LogFormatter& out, const T& value, bool logfmt)
+         {
+             typedef typename std::decay<T>::type Type;
+
+             if constexpr (LogFormatDetail::IsLazy<Type>::value)
+             {
+                 // A lazy argument is encoded by the type of its result
+                 encode(out, value(), logfmt);
+             }
+             else if constexpr (std::is_same<Type, bool>::value)
+             {
+                 if (value)
+                     out.append("true", 4);
+                 else
+                     out.append("false", 5);
+             }
+             else if constexpr (std::is_integral<Type>::value &&
+                                !std::is_same<Type, char>::value &&
+                                !std::is_same<Type, signed char>::value &&
+                                !std::is_same<Type, unsigned char>::value)
+             {
+                 out.write(value);
+             }
+             else if constexpr (std::is_floating_point<Type>::value)
+             {
+                 // JSON has no NaN or infinity, they become strings. None of the names needs
+                 // escaping or logfmt quoting, so they skip the scan.
+                 if (std::isfinite(value))
+                 {
+                     out.write(value);
+                 }
+                 else
+                 {
+                     const std::string_view name = std::isnan(value) ? std::string_view("nan", 3) :
+                                                   (value > 0 ? std::string_view("inf", 3) : std::string_view("-inf", 4));
+                     if (!logfmt)
+                         out.append('"');
+                     out.append(name);
+                     if (!logfmt)
+                         out.append('"');
+                 }
+             }
+             else if constexpr (std::is_array<T>::value &&
+                                std::is_same<typename std::remove_cv<typename std::remove_extent<T>::type>::type, char>::value)
+             {
+                 encodeString(out, std::string_view(value, strnlen(value, std::extent<T>::value)), logfmt);
+             }
+             else if constexpr (std::is_same<Type, char*>::value || std::is_same<Type, const char*>::value)
+             {
+                 encodeString(out, value ? std::string_view(value) : std::string_view("(null)"), logfmt);
+             }
+             else if constexpr (std::is_convertible<const T&, std::string_view>::value)
+             {
+                 encodeString(out, std::string_view(value), logfmt);
+             }
+             else
+             {
+                 // Characters, pointers and user types: their text rendering, as a string
+                 LogFormatter text;
+                 text.write(value);
+                 encodeString(out, text.view(), logfmt);
+             }
+         }
+
+         static void encodeString(LogFormatter& out, std::string_view text, bool logfmt)
+         {
+             if (logfmt)
+                 logfmtString(out, text);
+             else
+                 jsonString(out, text);
+         }
+
+         static char hexDigit(unsigned v) { return "0123456789abcdef"[v & 0x0f]; }
+
+         static bool special(unsigned char c, bool logfmt)
+         {
+             return c < 0x20 || c == '"' || c == '\\' || (logfmt && (c == ' ' || c == '='));
+         }
+
+         ///
+         /// Position of the first byte that needs escaping (or quoting, for logfmt) at or after 'pos'
+         ///
+         static size_t scan(const char* data, size_t length, size_t pos, bool logfmt)
+         {
+#if defined(__SSE2__)
+             const __m128i quote     = _mm_set1_epi8('"');
+             const __m128i backslash = _mm_set1_epi8('\\');
+             const __m128i control   = _mm_set1_epi8(0x1f);
+             const __m128i space     = _mm_set1_epi8(logfmt ? ' ' : '"');
+             const __m128i equals    = _mm_set1_epi8(logfmt ? '=' : '"');
+             for (; pos + 16 <= length; pos += 16)
+             {
+                 const __m128i v = _mm_loadu_si128((const __m128i*)(data + pos));
+
+                 // Unsigned v <= 0x1f, so UTF-8 bytes are left alone
+                 __m128i hit = _mm_cmpeq_epi8(_mm_max_epu8(v, control), control);
+                 hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, quote));
+                 hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+                 hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, space));
+                 hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, equals));
+
+                 const int mask = _mm_movemask_epi8(hit);
+                 if (mask != 0)
+                     return pos + __builtin_ctz(mask);
+             }
+#endif
+             for (; pos < length; ++pos)
+             {
+                 if (special((unsigned char)data[pos], logfmt))
+                     return pos;
+             }
+             return length;
+         }
+    };
+
+} // End of namespace
+
+#endif // End of _STRUCTURED_FORMAT_H_
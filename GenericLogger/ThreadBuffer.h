@@ -0,0 +1,52 @@
+#ifndef _THREAD_BUFFER_H_
+#define _THREAD_BUFFER_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <string>
+
+// POSIX Socket Header File(s)
+#include <pthread.h>
+
+namespace CPlusPlusLogging
+{
+    // Bytes a thread collects before it hands its batch over to the writer thread
+    #define DEFAULT_BATCH_BUFFER_SIZE   (64 * 1024)
+
+    // Full batches waiting for the writer before producers start to wait for it
+    #define MAX_PENDING_BATCHES         64
+
+    ///
+    /// A run of complete, newline terminated lines bound for one destination
+    ///
+    struct LogBatch
+    {
+        int          type;          // LogType of every line in the batch
+        std::string  data;
+    };
+
+    ///
+    /// Lines appended by one thread in batched mode. The lock is only ever contended when the
+    /// writer thread comes by to collect a partial batch, so producers do not share a cacheline.
+    ///
+    struct ThreadBuffer
+    {
+        pthread_mutex_t     lock;
+        int                 type;
+        std::string         data;
+        bool                retired;    // owning thread has exited, free once drained
+
+        ThreadBuffer() : type(0), retired(false)
+        {
+            pthread_mutex_init(&lock, NULL);
+        }
+
+        ~ThreadBuffer()
+        {
+            pthread_mutex_destroy(&lock);
+        }
+    };
+
+} // End of namespace
+
+#endif // End of _THREAD_BUFFER_H_
@@ -0,0 +1,148 @@
+#ifndef _TIMESTAMP_H_
+#define _TIMESTAMP_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+namespace CPlusPlusLogging
+{
+    // enum for the sub-second digits appended to "YYYY-MM-DD HH:MM:SS"
+    typedef enum TIMESTAMP_PRECISION
+    {
+      TIMESTAMP_SECONDS = 0,
+      TIMESTAMP_MILLIS  = 3,
+      TIMESTAMP_MICROS  = 6,
+    } TimestampPrecision;
+
+    // Length of "YYYY-MM-DD HH:MM:SS" and room for a full timestamp plus NUL
+    #define TIMESTAMP_SECOND_LENGTH 19
+    #define TIMESTAMP_MAX_LENGTH    32
+
+    ///
+    /// Renders record timestamps without calling localtime/strftime for every record. The date and
+    /// time of day are rendered once per second and published through a seqlock, so every thread
+    /// shares them without taking a lock; the sub-second digits are patched in per call. Seconds and
+    /// milliseconds come from CLOCK_REALTIME_COARSE, microseconds need the precise CLOCK_REALTIME.
+    ///
+    class TimestampCache
+    {
+      public:
+         TimestampCache()
+         {
+             m_Precision.store(TIMESTAMP_SECONDS);
+             m_Seq.store(0);
+             m_Second.store(-1);
+             for (int i = 0; i < 3; ++i)
+                 m_Text[i].store(0);
+         }
+
+         void setPrecision(TimestampPrecision precision) { m_Precision.store(precision, std::memory_order_relaxed); }
+
+         ///
+         /// Writes the current time into 'out' (at least TIMESTAMP_MAX_LENGTH bytes), returns the length
+         ///
+         size_t now(char* out)
+         {
+             const TimestampPrecision precision = m_Precision.load(std::memory_order_relaxed);
+
+             struct timespec ts;
+             clock_gettime(precision == TIMESTAMP_MICROS ? CLOCK_REALTIME : CLOCK_REALTIME_COARSE, &ts);
+             return render(ts.tv_sec, ts.tv_nsec, precision, out);
+         }
+
+         ///
+         /// Same for a CLOCK_REALTIME timestamp in nanoseconds taken earlier
+         ///
+         size_t render(uint64_t realtimeNs, char* out)
+         {
+             return render((int64_t)(realtimeNs / 1000000000ull), (long)(realtimeNs % 1000000000ull),
+                           m_Precision.load(std::memory_order_relaxed), out);
+         }
+
+      private:
+         size_t render(int64_t second, long nanosecond, TimestampPrecision precision, char* out)
+         {
+             if (!load(second, out))
+             {
+                 renderSecond(second, out);
+                 store(second, out);
+             }
+
+             size_t length = TIMESTAMP_SECOND_LENGTH;
+             if (precision != TIMESTAMP_SECONDS)
+             {
+                 long fraction = nanosecond;
+                 for (int i = precision; i < 9; ++i)
+                     fraction /= 10;
+
+                 out[length] = '.';
+                 for (int i = precision; i > 0; --i)
+                 {
+                     out[length + i] = (char)('0' + fraction % 10);
+                     fraction /= 10;
+                 }
+                 length += 1 + precision;
+             }
+             out[length] = '\0';
+             return length;
+         }
+
+         static void renderSecond(int64_t second, char* out)
+         {
+             time_t    seconds = (time_t)second;
+             struct tm local;
+             localtime_r(&seconds, &local);
+             if (strftime(out, TIMESTAMP_MAX_LENGTH, "%Y-%m-%d %H:%M:%S", &local) != TIMESTAMP_SECOND_LENGTH)
+                 memset(out, '?', TIMESTAMP_SECOND_LENGTH);
+         }
+
+         /// Seqlock read, fails if the cached second differs or a writer is active
+         bool load(int64_t second, char* out) const
+         {
+             const uint32_t begin = m_Seq.load(std::memory_order_acquire);
+             if (begin & 1)
+                 return false;
+
+             // Acquire loads keep the second read of m_Seq behind the data
+             uint64_t text[3];
+             const int64_t cached = m_Second.load(std::memory_order_acquire);
+             for (int i = 0; i < 3; ++i)
+                 text[i] = m_Text[i].load(std::memory_order_acquire);
+
+             if (m_Seq.load(std::memory_order_relaxed) != begin || cached != second)
+                 return false;
+
+             memcpy(out, text, TIMESTAMP_SECOND_LENGTH);
+             return true;
+         }
+
+         /// Seqlock write, skipped if another thread is publishing at the same time
+         void store(int64_t second, const char* rendered)
+         {
+             uint32_t seq = m_Seq.load(std::memory_order_relaxed);
+             if ((seq & 1) || !m_Seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+                 return;
+
+             // Release stores: a reader that sees new data also sees the odd sequence
+             uint64_t text[3] = { 0, 0, 0 };
+             memcpy(text, rendered, TIMESTAMP_SECOND_LENGTH);
+             m_Second.store(second, std::memory_order_release);
+             for (int i = 0; i < 3; ++i)
+                 m_Text[i].store(text[i], std::memory_order_release);
+
+             m_Seq.store(seq + 2, std::memory_order_release);
+         }
+
+      private:
+         std::atomic<TimestampPrecision> m_Precision;
+         std::atomic<uint32_t>           m_Seq;
+         std::atomic<int64_t>            m_Second;
+         std::atomic<uint64_t>           m_Text[3];      // "YYYY-MM-DD HH:MM:SS", 19 of 24 bytes used
+    };
+
+} // End of namespace
+
+#endif // End of _TIMESTAMP_H_
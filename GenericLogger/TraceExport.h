@@ -0,0 +1,165 @@
+#ifndef _TRACE_EXPORT_H_
+#define _TRACE_EXPORT_H_
+
+// C++ Header File(s)
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Code Specific Header Files(s)
+#include "LogFormatter.h"
+#include "StructuredFormat.h"
+
+namespace CPlusPlusLogging
+{
+    // Trace events collected before they are written out, see Logger::enableTraceExport()
+    #define TRACE_BUFFER_SIZE           (64 * 1024)
+
+    ///
+    /// Writes spans as Chrome trace events in the JSON array format, which chrome://tracing and
+    /// Perfetto load as they are. Each span is one complete event ("ph":"X") with microsecond
+    /// "ts" and "dur". Events are appended to a shared buffer under a mutex and written once
+    /// TRACE_BUFFER_SIZE bytes are pending, on flush() and on close(). The closing bracket is
+    /// optional in this format, so a file cut short by a crash still loads.
+    ///
+    class TraceExport
+    {
+      public:
+         TraceExport() : m_Fd(-1), m_First(true)
+         {
+             m_ProcessId.store(0);
+             pthread_mutex_init(&m_Mutex, NULL);
+         }
+
+         ~TraceExport()
+         {
+             close();
+             pthread_mutex_destroy(&m_Mutex);
+         }
+
+         bool open(const std::string& path)
+         {
+             close();
+
+             const int fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+             if (fd < 0)
+                 return false;
+
+             pthread_mutex_lock(&m_Mutex);
+             m_Fd        = fd;
+             m_First     = true;
+             m_ProcessId.store((long)getpid(), std::memory_order_relaxed);
+             m_Buffer.reserve(TRACE_BUFFER_SIZE + LOG_FORMAT_INLINE_SIZE);
+             m_Buffer.assign("[\n");
+             pthread_mutex_unlock(&m_Mutex);
+             return true;
+         }
+
+         void close()
+         {
+             pthread_mutex_lock(&m_Mutex);
+             if (m_Fd >= 0)
+             {
+                 m_Buffer.append("\n]\n");
+                 writeOut();
+                 ::close(m_Fd);
+                 m_Fd = -1;
+             }
+             pthread_mutex_unlock(&m_Mutex);
+         }
+
+         void flush()
+         {
+             pthread_mutex_lock(&m_Mutex);
+             if (m_Fd >= 0)
+                 writeOut();
+             pthread_mutex_unlock(&m_Mutex);
+         }
+
+         ///
+         /// One complete event. The event is rendered on the caller's stack, the lock only
+         /// covers the append and, every TRACE_BUFFER_SIZE bytes, the write.
+         ///
+         void complete(std::string_view name, std::string_view category,
+                       uint64_t startNs, uint64_t durationNs, long threadId)
+         {
+             LogFormatter event;
+             event.append("{\"name\":", 8);
+             StructuredFormat::jsonString(event, name);
+             event.append(",\"cat\":", 7);
+             StructuredFormat::jsonString(event, category.empty() ? std::string_view("log") : category);
+             event.append(",\"ph\":\"X\",\"ts\":", 15);
+             writeMicros(event, startNs);
+             event.append(",\"dur\":", 7);
+             writeMicros(event, durationNs);
+             event.append(",\"pid\":", 7);
+             event.write(m_ProcessId.load(std::memory_order_relaxed));
+             event.append(",\"tid\":", 7);
+             event.write(threadId);
+             event.append('}');
+
+             pthread_mutex_lock(&m_Mutex);
+             if (m_Fd >= 0)
+             {
+                 if (!m_First)
+                     m_Buffer.append(",\n", 2);
+                 m_First = false;
+                 m_Buffer.append(event.view().data(), event.view().size());
+                 if (m_Buffer.size() >= TRACE_BUFFER_SIZE)
+                     writeOut();
+             }
+             pthread_mutex_unlock(&m_Mutex);
+         }
+
+         /// "12.345" for 12345ns
+         static void writeMicros(LogFormatter& out, uint64_t ns)
+         {
+             const unsigned fraction = (unsigned)(ns % 1000);
+             const char digits[4] = { '.', (char)('0' + fraction / 100), (char)('0' + fraction / 10 % 10),
+                                      (char)('0' + fraction % 10) };
+             out.write(ns / 1000);
+             out.append(digits, 4);
+         }
+
+      private:
+         /// Called with m_Mutex held
+         void writeOut()
+         {
+             size_t done = 0;
+             while (done < m_Buffer.size())
+             {
+                 const ssize_t n = ::write(m_Fd, m_Buffer.data() + done, m_Buffer.size() - done);
+                 if (n < 0 && errno == EINTR)
+                     continue;
+                 if (n <= 0)
+                 {
+                     printf("TraceExport::writeOut() -- Unable to write the trace file, events lost!!\n");
+                     break;
+                 }
+                 done += (size_t)n;
+             }
+             m_Buffer.clear();
+         }
+
+         TraceExport(const TraceExport& obj);
+         void operator=(const TraceExport& obj);
+
+      private:
+         pthread_mutex_t     m_Mutex;
+         int                 m_Fd;
+         bool                m_First;
+         std::atomic<long>   m_ProcessId;       // read without the lock
+         std::string         m_Buffer;
+    };
+
+} // End of namespace
+
+#endif // End of _TRACE_EXPORT_H_
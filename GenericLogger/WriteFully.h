@@ -0,0 +1,41 @@
+#ifndef _WRITE_FULLY_H_
+#define _WRITE_FULLY_H_
+
+// POSIX Socket Header File(s)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+namespace CPlusPlusLogging
+{
+    ///
+    /// writev() that copes with short writes and EINTR, and gives up on any other failure.
+    /// 'iov' is used up on the way. Only calls writev(), so it can run from a signal handler.
+    ///
+    inline void writeFully(int fd, struct iovec* iov, int count)
+    {
+        while (count > 0)
+        {
+            ssize_t written = writev(fd, iov, count);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return;
+
+            while (count > 0 && (size_t)written >= iov->iov_len)
+            {
+                written -= (ssize_t)iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0)
+            {
+                iov->iov_base = (char*)iov->iov_base + written;
+                iov->iov_len -= (size_t)written;
+            }
+        }
+    }
+
+} // End of namespace
+
+#endif // End of _WRITE_FULLY_H_
@@ -0,0 +1,172 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Code Specific Header Files(s)
+#include <benchmark/benchmark.h>
+#include "Logger.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// logger_bench measures the hot paths of the logger: the cost of a disabled statement,
+/// single-threaded ns/call of the common statement shapes and the multi-threaded throughput
+/// of every output mode at 1 to 64 threads. Records go to LOG_FILE_NAME, console records to
+/// /dev/null. tools/bench_regress.sh keeps one JSON result per commit and compares them.
+///
+
+namespace
+{
+   int g_Stdout = -1;
+
+   Logger* logger() { return Logger::getInstance(); }
+
+   ///
+   /// Puts the logger into one output mode. Setup/teardown run once per benchmark run,
+   /// outside of the timed threads.
+   ///
+   enum Mode { MODE_FILE, MODE_CONSOLE, MODE_ASYNC, MODE_BATCHED, MODE_URING, MODE_MMAP };
+
+   void enterMode(Mode mode)
+   {
+      Logger* log = logger();
+      log->setLogLevel(LOG_LEVEL_INFO);
+      switch(mode)
+      {
+         case MODE_CONSOLE:
+            // The console writes to descriptor 1, the reporter to cout, but only between runs
+            cout.flush();
+            fflush(stdout);
+            g_Stdout = dup(STDOUT_FILENO);
+            {
+               const int null = open("/dev/null", O_WRONLY);
+               dup2(null, STDOUT_FILENO);
+               close(null);
+            }
+            log->setLogType(CONSOLE);
+            break;
+         case MODE_ASYNC:
+            log->setLogType(FILE_LOG);
+            log->enableAsyncLog(1 << 16, OVERFLOW_BLOCK);
+            break;
+         case MODE_BATCHED:
+            log->setLogType(FILE_LOG);
+            log->enableBatchedLog();
+            break;
+         case MODE_URING:
+            log->setLogType(FILE_LOG);
+            log->setFileBackend(FILE_BACKEND_URING);
+            log->enableBatchedLog();
+            break;
+         case MODE_MMAP:
+            log->setLogType(MMAP_FILE_LOG);
+            break;
+         default:
+            log->setLogType(FILE_LOG);
+            break;
+      }
+   }
+
+   void leaveMode()
+   {
+      Logger* log = logger();
+      log->flush();
+      log->disableAsyncLog();
+      log->disableBatchedLog();
+      log->setFileBackend(FILE_BACKEND_WRITEV);
+      log->setLogType(FILE_LOG);
+      if(g_Stdout >= 0)
+      {
+         dup2(g_Stdout, STDOUT_FILENO);
+         close(g_Stdout);
+         g_Stdout = -1;
+      }
+   }
+
+   template <Mode M> void setup(const benchmark::State&)    { enterMode(M); }
+   void teardown(const benchmark::State&)                   { leaveMode(); }
+}
+
+///
+/// A statement below the runtime level: the level check only
+///
+static void BM_Disabled(benchmark::State& state)
+{
+   logger()->setLogLevel(LOG_LEVEL_ERROR);
+   int i = 0;
+   for(auto _ : state)
+      LOG_DEBUG("not logged", ++i);
+   logger()->setLogLevel(LOG_LEVEL_INFO);
+}
+BENCHMARK(BM_Disabled);
+
+static void BM_PlainText(benchmark::State& state)
+{
+   for(auto _ : state)
+      LOG_INFO("connection accepted");
+}
+BENCHMARK(BM_PlainText)->Setup(setup<MODE_FILE>)->Teardown(teardown);
+
+static void BM_Variadic(benchmark::State& state)
+{
+   int i = 0;
+   for(auto _ : state)
+      LOG_INFO("request", ++i, "took", 12.5, "ms");
+}
+BENCHMARK(BM_Variadic)->Setup(setup<MODE_FILE>)->Teardown(teardown);
+
+static void BM_FormatString(benchmark::State& state)
+{
+   int i = 0;
+   for(auto _ : state)
+      LOG_INFO_F("request {} took {}ms", ++i, 12.5);
+}
+BENCHMARK(BM_FormatString)->Setup(setup<MODE_FILE>)->Teardown(teardown);
+
+///
+/// Hexdump of a buffer of state.range(0) bytes
+///
+static void BM_BufferDump(benchmark::State& state)
+{
+   logger()->setLogLevel(LOG_LEVEL_BUFFER);
+   vector<unsigned char> data(state.range(0));
+   for(size_t i = 0; i < data.size(); ++i)
+      data[i] = (unsigned char)(i * 31);
+
+   for(auto _ : state)
+      LOG_BUFFER(data.data(), data.size());
+   state.SetBytesProcessed(state.iterations() * state.range(0));
+   logger()->setLogLevel(LOG_LEVEL_INFO);
+}
+BENCHMARK(BM_BufferDump)->Arg(64)->Arg(4096)->Arg(64 * 1024)->Setup(setup<MODE_FILE>)->Teardown(teardown);
+
+///
+/// Records per second of all threads together, per output mode
+///
+static void BM_Throughput(benchmark::State& state)
+{
+   int i = 0;
+   for(auto _ : state)
+      LOG_INFO("request", ++i, "took", 12.5, "ms");
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/file")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_FILE>)->Teardown(teardown);
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/console")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_CONSOLE>)->Teardown(teardown);
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/async")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_ASYNC>)->Teardown(teardown);
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/batched")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_BATCHED>)->Teardown(teardown);
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/uring")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_URING>)->Teardown(teardown);
+BENCHMARK(BM_Throughput)->Name("BM_Throughput/mmap")->ThreadRange(1, 64)->UseRealTime()
+   ->Setup(setup<MODE_MMAP>)->Teardown(teardown);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "Logger.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// Round trip of the binary encoding: the same calls are logged as text and as binary
+/// records, and log_decoder (argv[1]) has to turn the binary file into the text lines
+///
+
+/// The lines of a log file without their timestamps
+static vector<string> records(const string& text)
+{
+    vector<string> lines;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if (end == string::npos)
+            end = text.size();
+        const string line  = text.substr(pos, end - pos);
+        const size_t stamp = line.find("  ");
+        lines.push_back(stamp == string::npos ? line : line.substr(stamp + 2));
+        pos = end + 1;
+    }
+    return lines;
+}
+
+/// One call site for both loggers, so both get the same prefix
+static void logAll(Logger* log)
+{
+    const string long_text(3000, 'x');
+    const string name = "std::string";
+    for (int i = 0; i < 100; ++i)
+    {
+        LOG_INFO_TO(log, "record", i, -i * 1000LL, (unsigned long long)i << 40, 12.5 * i, 1e-7);
+        LOG_ERROR_TO(log, "error", 'c', true, false, name, "literal");
+        LOG_DEBUG_TO(log, "filtered", i);
+    }
+    LOG_WARNING_TO(log, "long", long_text);
+    LOG_INFO_TO(log, "lazy", [&] { return 42; });
+}
+
+static string decode(const string& decoder, const string& file, const string& options)
+{
+    string output;
+    FILE*  pipe = popen((decoder + " " + file + " " + options).c_str(), "r");
+    if (pipe == NULL)
+        return output;
+
+    char   chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0)
+        output.append(chunk, n);
+    CHECK(pclose(pipe) == 0);
+    return output;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <log_decoder>\n", argv[0]);
+        return 1;
+    }
+
+    TestDir dir("binarylog");
+
+    Logger* text = Logger::get("text", dir.path("text.log"));
+    text->setLogLevel(LOG_LEVEL_INFO);
+    logAll(text);
+    text->flush();
+
+    Logger* binary = Logger::get("binary", dir.path("binary.log"));
+    binary->setLogLevel(LOG_LEVEL_INFO);
+    binary->enableAsyncLog();
+    binary->setLogEncoding(ENCODE_BINARY);
+    logAll(binary);
+    binary->disableAsyncLog();
+
+    const vector<string> expected = records(readFile(dir.path("text.log")));
+    const vector<string> decoded  = records(decode(argv[1], dir.path("binary.log.bin"), ""));
+    CHECK(expected.size() == 202);
+    CHECK(decoded.size() == expected.size());
+    for (size_t i = 0; i < expected.size() && i < decoded.size(); ++i)
+    {
+        if (decoded[i] != expected[i])
+        {
+            printf("line %zu: \"%s\" != \"%s\"\n", i, decoded[i].c_str(), expected[i].c_str());
+            CHECK(decoded[i] == expected[i]);
+            break;
+        }
+    }
+
+    // Nothing else went to the text file of the binary logger
+    CHECK(readFile(dir.path("binary.log")).empty());
+
+    // --level keeps the records up to the given level
+    const vector<string> errors = records(decode(argv[1], dir.path("binary.log.bin"), "--level 2"));
+    CHECK(errors.size() == 100);
+    for (size_t i = 0; i < errors.size(); ++i)
+        CHECK(errors[i].find("[ERROR]") != string::npos);
+
+    return testResult("BinaryLogTest");
+}
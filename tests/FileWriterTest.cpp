@@ -0,0 +1,97 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+
+// Code Specific Header Files(s)
+#include "FileWriter.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// FileWriter with both backends, through the page cache and with O_DIRECT: the partial last
+/// block carried over flush() and the next open(), buffers recycled while writes are in flight,
+/// and the reopen of a copy taken while the padded file was still open (a crash)
+///
+
+static string line(int i)
+{
+    return "line " + to_string(i) + " " + string((i * 53) % 700, (char)('a' + i % 26)) + "\n";
+}
+
+/// Appends lines [from, to) and flushes after every 'flushEvery' of them, returns what was written
+static string appendLines(FileWriter& writer, int from, int to, int flushEvery)
+{
+    string written;
+    for (int i = from; i < to; ++i)
+    {
+        const string text = line(i);
+        writer.append(text.data(), text.size());
+        written += text;
+        if (i % 10 == 0)
+            writer.submit();
+        if (flushEvery && i % flushEvery == 0)
+            writer.flush(i % (2 * flushEvery) == 0);
+    }
+    return written;
+}
+
+static void backend(const TestDir& dir, FileBackend backend, bool direct)
+{
+    const string name = string(backend == FILE_BACKEND_URING ? "uring" : "pwrite") + (direct ? "-direct" : "");
+    const string path = dir.path(name + ".log");
+
+    // Several MB, so every buffer is reused a few times, with flushes cutting blocks all over
+    FileWriter writer;
+    CHECK(writer.open(path, backend, direct));
+    const bool usedDirect = writer.direct();
+    const bool usedRing   = writer.usesRing();
+    string expected = appendLines(writer, 0, 12000, 7);
+
+    // Nothing but the unflushed lines is pending
+    const string unflushed = "not flushed yet\n";
+    writer.flush(false);
+    writer.append(unflushed.data(), unflushed.size());
+    expected += unflushed;
+    if (writer.direct())
+        CHECK(writer.pending() == unflushed);
+    writer.flush(true);
+    CHECK(readFile(path).compare(0, expected.size(), expected) == 0);
+    writer.close();
+    CHECK(readFile(path) == expected);
+
+    // A reopened file continues right after the last line, also in mid-block
+    CHECK(writer.open(path, backend, direct));
+    expected += appendLines(writer, 12000, 12100, 3);
+    writer.close();
+    CHECK(readFile(path) == expected);
+
+    // A copy taken after a flush while the file was open ends in the zero padding of O_DIRECT
+    const string copy = dir.path(name + ".copy");
+    CHECK(writer.open(path, backend, direct));
+    expected += appendLines(writer, 12100, 12105, 0);
+    writer.flush(false);
+    writeFile(copy, readFile(path));
+    writer.close();
+    CHECK(readFile(copy).compare(0, expected.size(), expected) == 0);
+
+    FileWriter reopened;
+    CHECK(reopened.open(copy, backend, direct));
+    expected += appendLines(reopened, 12105, 12110, 0);
+    reopened.close();
+    CHECK(readFile(copy) == expected);
+
+    printf("FileWriterTest: %s with%s O_DIRECT, with%s io_uring\n", name.c_str(),
+           usedDirect ? "" : "out", usedRing ? "" : "out");
+}
+
+int main()
+{
+    TestDir dir("filewriter");
+    backend(dir, FILE_BACKEND_PWRITE, false);
+    backend(dir, FILE_BACKEND_PWRITE, true);
+    backend(dir, FILE_BACKEND_URING, false);
+    backend(dir, FILE_BACKEND_URING, true);
+    return testResult("FileWriterTest");
+}
@@ -0,0 +1,76 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+
+// Code Specific Header Files(s)
+#include "FormatString.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// FormatString: the placeholder count and the pieces compile() cuts a format into, checked at
+/// compile time with the same constexpr calls Logger.h makes, then rendered at run time
+///
+
+/// compile() with the sizes Logger.h derives from the format itself
+#define COMPILED(format) FormatString::compile<(size_t)FormatString::count(format), std::string_view(format).size()>(format)
+
+// Placeholders
+static_assert(FormatString::count("") == 0, "empty format");
+static_assert(FormatString::count("no placeholder") == 0, "plain text");
+static_assert(FormatString::count("{}") == 1, "one placeholder");
+static_assert(FormatString::count("{}{}") == 2, "adjacent placeholders");
+static_assert(FormatString::count("a {} b {} c {}") == 3, "three placeholders");
+
+// Doubled braces are text, not placeholders
+static_assert(FormatString::count("{{}}") == 0, "escaped braces");
+static_assert(FormatString::count("{{{}}}") == 1, "placeholder inside escaped braces");
+static_assert(FormatString::count("}}{}{{") == 1, "escaped braces around a placeholder");
+
+// Malformed: a trailing '{', a stray '}', a brace inside the placeholder
+static_assert(FormatString::count("{") == -1, "lone '{'");
+static_assert(FormatString::count("value {") == -1, "trailing '{'");
+static_assert(FormatString::count("}") == -1, "lone '}'");
+static_assert(FormatString::count("a } b") == -1, "stray '}'");
+static_assert(FormatString::count("{}}") == -1, "stray '}' after a placeholder");
+static_assert(FormatString::count("{{}") == -1, "stray '}' after an escaped '{'");
+static_assert(FormatString::count("{x}") == -1, "named placeholder");
+
+// Pieces: the text around every placeholder, unescaped, at its offset in the compiled text
+constexpr auto PLAIN = COMPILED("plain");
+static_assert(PLAIN.piece(0) == "plain" && PLAIN.offset[0] == 0, "plain text is one piece");
+
+constexpr auto ADJACENT = COMPILED("a{}{}b");
+static_assert(ADJACENT.piece(0) == "a" && ADJACENT.piece(1) == "" && ADJACENT.piece(2) == "b", "adjacent pieces");
+static_assert(ADJACENT.offset[0] == 0 && ADJACENT.offset[1] == 1 && ADJACENT.offset[2] == 1, "adjacent offsets");
+
+constexpr auto EDGES = COMPILED("{} middle {}");
+static_assert(EDGES.piece(0) == "" && EDGES.piece(1) == " middle " && EDGES.piece(2) == "", "empty first and last piece");
+static_assert(EDGES.offset[1] == 0 && EDGES.offset[2] == 8, "offsets of the middle and last piece");
+
+constexpr auto ESCAPED = COMPILED("{{x}} = {}, }}{{");
+static_assert(ESCAPED.piece(0) == "{x} = " && ESCAPED.piece(1) == ", }{", "unescaped braces");
+static_assert(ESCAPED.offset[1] == 6 && ESCAPED.length[1] == 4, "offsets after unescaping");
+
+constexpr auto NESTED = COMPILED("{{{}}}");
+static_assert(NESTED.piece(0) == "{" && NESTED.piece(1) == "}", "placeholder between escaped braces");
+
+template <size_t Placeholders, size_t Length, typename... Args>
+static string render(const CompiledFormat<Placeholders, Length>& compiled, const Args&... args)
+{
+    LogFormatter out;
+    compiled.render(out, args...);
+    return string(out.view());
+}
+
+int main()
+{
+    CHECK(render(PLAIN) == "plain");
+    CHECK(render(ADJACENT, 1, 2) == "a12b");
+    CHECK(render(EDGES, "first", 'x') == "first middle x");
+    CHECK(render(ESCAPED, -7) == "{x} = -7, }{");
+    CHECK(render(NESTED, 3.5) == "{3.5}");
+    return testResult("FormatStringTest");
+}
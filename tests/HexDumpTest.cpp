@@ -0,0 +1,132 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+
+// Code Specific Header Files(s)
+#include "HexDump.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// HexDump: every length from 0 to 300, so full rows, partial rows of every size and bytes from
+/// 0x80 up in the ASCII column, against the "hexdump -C" layout and against hexdump itself where
+/// it is installed. Built twice, HexDumpScalarTest without the SIMD kernel.
+///
+
+static const size_t MAX_LENGTH = 300;
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+static const char* const KERNEL = "SIMD";
+#else
+static const char* const KERNEL = "scalar";
+#endif
+
+/// Every byte value, in an order that puts printable and non-printable ones side by side
+static string bytes(size_t length)
+{
+    string data;
+    for (size_t i = 0; i < length; ++i)
+        data += (char)((i * 73 + 5) & 0xff);
+    return data;
+}
+
+static string render(const string& data)
+{
+    LogFormatter out;
+    HexDump::render(out, data.data(), data.size());
+    return string(out.view());
+}
+
+/// What "hexdump -C -v" prints, without the final offset line and the last '\n'
+static string reference(const string& data)
+{
+    string expected;
+    for (size_t offset = 0; offset < data.size(); offset += 16)
+    {
+        char field[16];
+        snprintf(field, sizeof(field), "%s%08zx  ", offset ? "\n" : "", offset);
+        expected += field;
+        string ascii;
+        for (size_t i = 0; i < 16; ++i)
+        {
+            if (offset + i < data.size())
+            {
+                const unsigned char c = (unsigned char)data[offset + i];
+                snprintf(field, sizeof(field), "%02x ", c);
+                ascii += (c >= 0x20 && c < 0x7f) ? (char)c : '.';
+            }
+            else
+            {
+                snprintf(field, sizeof(field), "   ");
+            }
+            expected += field;
+            if (i == 7)
+                expected += " ";
+        }
+        expected += " |" + ascii + "|";
+    }
+    return expected;
+}
+
+static string hexdump(const TestDir& dir, const string& data)
+{
+    const string path = dir.path("bytes");
+    writeFile(path, data);
+
+    string output;
+    FILE*  pipe = popen(("hexdump -C -v " + path).c_str(), "r");
+    if (pipe == NULL)
+        return output;
+    char   chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0)
+        output.append(chunk, n);
+    pclose(pipe);
+
+    // The offset after the last byte ends the output
+    const size_t last = output.rfind('\n', output.size() >= 2 ? output.size() - 2 : 0);
+    return (last == string::npos) ? string() : output.substr(0, last);
+}
+
+static void layout()
+{
+    CHECK(render(string()).empty());
+    CHECK(render(string("Hello World!\n\x00\x01\x02", 16)) ==
+          "00000000  48 65 6c 6c 6f 20 57 6f  72 6c 64 21 0a 00 01 02  |Hello World!....|");
+    CHECK(render("\x7f\x80\xff ~") == "00000000  7f 80 ff 20 7e                                    |... ~|");
+
+    for (size_t length = 0; length <= MAX_LENGTH; ++length)
+        CHECK(render(bytes(length)) == reference(bytes(length)));
+
+    // Appended behind what the record already holds
+    LogFormatter out;
+    out.append("dump: ", 6);
+    HexDump::render(out, bytes(40).data(), 40);
+    CHECK(string(out.view()) == "dump: " + reference(bytes(40)));
+}
+
+static void againstHexdump()
+{
+    if (system("hexdump -C /dev/null > /dev/null 2>&1") != 0)
+    {
+        printf("HexDumpTest: hexdump not found, compared with the layout only\n");
+        return;
+    }
+
+    TestDir dir("hexdump");
+    for (size_t length = 1; length <= MAX_LENGTH; ++length)
+    {
+        const string data = bytes(length);
+        CHECK(render(data) == hexdump(dir, data));
+    }
+}
+
+int main()
+{
+    layout();
+    againstHexdump();
+    printf("HexDumpTest: %s kernel\n", KERNEL);
+    return testResult("HexDumpTest");
+}
@@ -0,0 +1,141 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <time.h>
+
+// Code Specific Header Files(s)
+#include "LogSampler.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// LogSampler: the pass pattern of every check, the "suppressed N" counts they hand back and
+/// the limits the GCRA rate limiter holds to, also under concurrent callers
+///
+
+static void sleepMs(long ms)
+{
+    struct timespec delay = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&delay, NULL);
+}
+
+static void everyN()
+{
+    LogSampler sampler{};
+    uint64_t   skipped = 1;
+    for (int i = 0; i < 10; ++i)
+    {
+        CHECK(sampler.everyN(3, skipped) == (i % 3 == 0));
+        CHECK(skipped == 0);
+    }
+
+    // 0 is taken as 1
+    LogSampler all{};
+    for (int i = 0; i < 5; ++i)
+        CHECK(all.everyN(0, skipped));
+}
+
+static void firstN()
+{
+    LogSampler sampler{};
+    uint64_t   skipped = 1;
+    CHECK(sampler.firstN(2, skipped) && skipped == 0);
+    CHECK(sampler.firstN(2, skipped) && skipped == 0);
+    for (int i = 0; i < 5; ++i)
+    {
+        CHECK(!sampler.firstN(2, skipped));
+        CHECK(skipped == 0);
+    }
+
+    // Once LOG_SAMPLER_SUMMARY_MS are over, the next call reports the suppressed ones
+    sampler.stamp.store(LogSampler::coarseMs() - LOG_SAMPLER_SUMMARY_MS - 1);
+    CHECK(!sampler.firstN(2, skipped));
+    CHECK(skipped == 6);
+    CHECK(!sampler.firstN(2, skipped));
+    CHECK(skipped == 0);
+}
+
+static void everyMs()
+{
+    LogSampler sampler{};
+    uint64_t   skipped = 1;
+    CHECK(sampler.everyMs(100, skipped) && skipped == 0);
+    for (int i = 0; i < 3; ++i)
+        CHECK(!sampler.everyMs(100, skipped));
+
+    sleepMs(120);
+    CHECK(sampler.everyMs(100, skipped));
+    CHECK(skipped == 3);
+}
+
+static void rateLimited()
+{
+    LogSampler sampler{};
+    uint64_t   skipped  = 0;
+    uint64_t   reported = 0;
+
+    // A full bucket lets the burst through at once, and nothing more
+    for (int i = 0; i < 5; ++i)
+        CHECK(sampler.rateLimited(100, 5, skipped));
+    CHECK(!sampler.rateLimited(100, 5, skipped));
+
+    // Then it is about 'perSecond', and every suppressed call shows up in a report
+    uint64_t calls  = 1;
+    uint64_t passed = 0;
+    const uint64_t until = LogSampler::preciseNs() + 500000000ull;
+    while (LogSampler::preciseNs() < until)
+    {
+        ++calls;
+        if (sampler.rateLimited(100, 5, skipped))
+        {
+            ++passed;
+            reported += skipped;
+        }
+        sleepMs(1);
+    }
+    CHECK(passed >= 40 && passed <= 56);
+    CHECK(passed + reported + sampler.suppressed.load() == calls);
+}
+
+static void concurrentRateLimited()
+{
+    LogSampler sampler{};
+    std::atomic<uint64_t> passed(0);
+
+    const uint64_t start = LogSampler::preciseNs();
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&sampler, &passed, start]
+        {
+            uint64_t skipped;
+            while (LogSampler::preciseNs() - start < 200000000ull)
+            {
+                if (sampler.rateLimited(1000, 10, skipped))
+                    passed.fetch_add(1);
+            }
+        });
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+    const double seconds = (LogSampler::preciseNs() - start) / 1e9;
+
+    // The compare-and-swap hands out every token once: never more than the burst plus the refill
+    CHECK(passed.load() <= 10 + (uint64_t)(1000 * seconds) + 1);
+    CHECK(passed.load() >= 150);
+}
+
+int main()
+{
+    everyN();
+    firstN();
+    everyMs();
+    rateLimited();
+    concurrentRateLimited();
+    return testResult("LogSamplerTest");
+}
@@ -0,0 +1,119 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <random>
+
+// Code Specific Header Files(s)
+#include "LogStats.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// Latency histograms: every value lands in the bucket whose range holds it, bucket edges sit on
+/// the powers of two and split them into 2^LATENCY_SUB_BITS, everything from 2^LATENCY_MAX_BITS
+/// up shares the last bucket, and the percentiles of a known distribution
+///
+
+static const size_t   LAST = LATENCY_BUCKETS - 1;
+static const uint64_t CAP  = 1ull << LATENCY_MAX_BITS;
+
+/// 'v' is in [upperBound(index - 1) + 1, upperBound(index)]
+static bool inBucket(uint64_t v)
+{
+    const size_t bucket = LatencyBuckets::index(v);
+    return bucket < LATENCY_BUCKETS && LatencyBuckets::upperBound(bucket) >= v &&
+           (bucket == 0 || LatencyBuckets::upperBound(bucket - 1) < v);
+}
+
+static void buckets()
+{
+    // Every small value, then around every power of two and at random
+    for (uint64_t v = 0; v < 70000; ++v)
+        CHECK(inBucket(v));
+    for (unsigned k = 0; k < 64; ++k)
+    {
+        const uint64_t power = 1ull << k;
+        CHECK(inBucket(power - 1) && inBucket(power) && inBucket(power + 1));
+    }
+    mt19937_64 random(42);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const uint64_t v = random() >> (random() % 64);
+        CHECK(inBucket(v));
+    }
+    CHECK(inBucket(UINT64_MAX));
+
+    // Each bucket ends right before the next begins, the buckets cover all values
+    for (size_t b = 0; b < LAST; ++b)
+    {
+        CHECK(LatencyBuckets::index(LatencyBuckets::upperBound(b)) == b);
+        CHECK(LatencyBuckets::index(LatencyBuckets::upperBound(b) + 1) == b + 1);
+    }
+
+    // Below 2^SUB_BITS one bucket per value, above every power of two starts a bucket and is
+    // cut into 2^SUB_BITS of equal width, 12.5% of it
+    for (uint64_t v = 0; v < (1u << LATENCY_SUB_BITS); ++v)
+        CHECK(LatencyBuckets::index(v) == v && LatencyBuckets::upperBound(v) == v);
+    for (unsigned k = LATENCY_SUB_BITS; k < LATENCY_MAX_BITS; ++k)
+    {
+        const size_t   first = LatencyBuckets::index(1ull << k);
+        const uint64_t width = 1ull << (k - LATENCY_SUB_BITS);
+        CHECK(first == (k - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS);
+        CHECK(LatencyBuckets::upperBound(first - 1) == (1ull << k) - 1);
+        for (size_t sub = 0; sub + 1 < (1u << LATENCY_SUB_BITS); ++sub)
+            CHECK(LatencyBuckets::upperBound(first + sub) == (1ull << k) + (sub + 1) * width - 1);
+    }
+
+    // The cap: 2^MAX_BITS and anything larger share the last bucket, which holds them all
+    CHECK(LatencyBuckets::index(CAP - 1) == LAST);
+    CHECK(LatencyBuckets::index(CAP) == LAST);
+    CHECK(LatencyBuckets::index(UINT64_MAX) == LAST);
+    CHECK(LatencyBuckets::upperBound(LAST - 1) < CAP - 1);
+    CHECK(LatencyBuckets::upperBound(LAST) == UINT64_MAX);
+}
+
+static LatencySnapshot snapshot(const LatencyHistogram& histogram)
+{
+    LatencySnapshot result;
+    histogram.addTo(result);
+    return result;
+}
+
+static void percentiles()
+{
+    CHECK(LatencySnapshot().percentileNs(0.5) == 0);
+
+    // 1 .. 10000 ns once each: the quantile's own bucket, capped at the largest value
+    LatencyHistogram uniform;
+    for (uint64_t v = 1; v <= 10000; ++v)
+        uniform.record(v);
+    const LatencySnapshot flat = snapshot(uniform);
+    CHECK(flat.count == 10000 && flat.maxNs == 10000 && flat.meanNs() == 5000);
+    CHECK(flat.percentileNs(0.5) == LatencyBuckets::upperBound(LatencyBuckets::index(5000)));
+    CHECK(flat.percentileNs(0.5) >= 5000 && flat.percentileNs(0.5) < 5000 * 1.125);
+    CHECK(flat.percentileNs(0.9) == LatencyBuckets::upperBound(LatencyBuckets::index(9000)));
+    CHECK(flat.percentileNs(0.99) == 10000);
+    CHECK(flat.percentileNs(1.0) == 10000);
+    CHECK(flat.percentileNs(0.0) == 1);
+    CHECK(flat.countAtMost(LatencyBuckets::upperBound(LatencyBuckets::index(5000))) ==
+          LatencyBuckets::upperBound(LatencyBuckets::index(5000)));
+
+    // 99 fast calls and one stuck for longer than the cap: p99 is the fast ones, the tail the real maximum
+    LatencyHistogram stalled;
+    for (int i = 0; i < 99; ++i)
+        stalled.record(1000);
+    stalled.record(2 * CAP);
+    const LatencySnapshot tail = snapshot(stalled);
+    CHECK(tail.percentileNs(0.5) == 1023);
+    CHECK(tail.percentileNs(0.99) == 1023);
+    CHECK(tail.percentileNs(1.0) == 2 * CAP);
+    CHECK(tail.countAtMost(CAP) == 99);
+}
+
+int main()
+{
+    buckets();
+    percentiles();
+    return testResult("LogStatsTest");
+}
@@ -0,0 +1,129 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "MappedFile.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// MappedFile: concurrent appends across extents, the truncation on close() and the reopen of
+/// a file whose zero filled pre-allocated tail was left behind by a crash
+///
+
+static const int THREADS = 4;
+static const int RECORDS = 5000;
+
+static string record(int thread, int i)
+{
+    // Lengths vary, so records straddle the one-page extents used below
+    return "thread " + to_string(thread) + " record " + to_string(i) + " " + string(i % 97, '.') + "\n";
+}
+
+static void concurrentAppends(const TestDir& dir)
+{
+    const string path = dir.path("concurrent.log");
+    MappedFile file;
+    CHECK(file.open(path, 4096));
+
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&file, t]
+        {
+            for (int i = 0; i < RECORDS; ++i)
+            {
+                const string text = record(t, i);
+                file.write(text.data(), text.size());
+            }
+        });
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    // Larger than an extent
+    const string big(10000, 'b');
+    file.write(big.data(), big.size());
+    file.write("\n", 1);
+    file.close();
+
+    size_t expected = big.size() + 1;
+    for (int t = 0; t < THREADS; ++t)
+        for (int i = 0; i < RECORDS; ++i)
+            expected += record(t, i).size();
+
+    // close() cut the pre-allocated space off
+    const string content = readFile(path);
+    CHECK(content.size() == expected);
+    CHECK(content.find('\0') == string::npos);
+
+    // Every thread's records arrived whole and in order
+    vector<int> next(THREADS, 0);
+    size_t pos = 0;
+    while (pos < content.size())
+    {
+        const size_t end  = content.find('\n', pos);
+        const string line = content.substr(pos, end - pos + 1);
+        pos = end + 1;
+        if (line == big + "\n")
+            continue;
+
+        int t = -1, i = -1;
+        if (sscanf(line.c_str(), "thread %d record %d", &t, &i) != 2 || t < 0 || t >= THREADS)
+        {
+            CHECK(!"malformed record");
+            break;
+        }
+        CHECK(i == next[t]);
+        CHECK(line == record(t, i));
+        next[t] = i + 1;
+    }
+    for (int t = 0; t < THREADS; ++t)
+        CHECK(next[t] == RECORDS);
+}
+
+static void reopenAfterCrash(const TestDir& dir)
+{
+    // A crashed run leaves its records followed by the zeros of the pre-allocated extent
+    const string path = dir.path("crashed.log");
+    writeFile(path, "abc\n" + string(3 * 4096 + 100, '\0'));
+
+    MappedFile file;
+    CHECK(file.open(path, 4096));
+    file.write("def\n", 4);
+    file.close();
+    CHECK(readFile(path) == "abc\ndef\n");
+
+    // The same for a file that is all zeros, and one only copied while still mapped
+    writeFile(path, string(8192, '\0'));
+    CHECK(file.open(path, 4096));
+    file.write("x\n", 2);
+    file.close();
+    CHECK(readFile(path) == "x\n");
+
+    const string copy = dir.path("copy.log");
+    CHECK(file.open(path, 4096));
+    file.write("y\n", 2);
+    writeFile(copy, readFile(path));
+    CHECK(readFile(copy).size() > 4);
+    file.close();
+
+    MappedFile reopened;
+    CHECK(reopened.open(copy, 4096));
+    reopened.write("z\n", 2);
+    reopened.close();
+    CHECK(readFile(copy) == "x\ny\nz\n");
+}
+
+int main()
+{
+    TestDir dir("mappedfile");
+    concurrentAppends(dir);
+    reopenAfterCrash(dir);
+    return testResult("MappedFileTest");
+}
@@ -0,0 +1,175 @@
+// C++ Header File(s)
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// POSIX Socket Header File(s)
+#include <arpa/inet.h>
+#include <time.h>
+
+// Code Specific Header Files(s)
+#include "NetworkSink.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// NetworkSink over TCP: a collector that does not read makes the sink stop on partial sends
+/// and compact its spill buffer, then drops the connection. The records that are not out in
+/// full have to arrive again on the next connection, as whole RFC 6587 frames.
+///
+
+static const int RECORDS = 4000;
+
+static string record(int i)
+{
+    return "record " + to_string(i) + " " + string(500 + (i * 37) % 3000, (char)('a' + i % 26));
+}
+
+static void sleepMs(long ms)
+{
+    struct timespec delay = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&delay, NULL);
+}
+
+/// Listens on an ephemeral loopback port, with a receive buffer as small as the kernel allows
+static int listener(string& port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int small = 4096;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr*)&address, &length) != 0)
+    {
+        printf("NetworkSinkTest: Unable to listen on the loopback interface!!\n");
+        exit(1);
+    }
+    port = to_string(ntohs(address.sin_port));
+    return fd;
+}
+
+/// Accepts the sink's next connection, driving its reconnect meanwhile
+static int acceptSink(int listenFd, NetworkSink& sink)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        sink.idle();
+        struct pollfd pfd = { listenFd, POLLIN, 0 };
+        if (poll(&pfd, 1, 10) > 0)
+            return accept4(listenFd, NULL, NULL, SOCK_NONBLOCK);
+    }
+    return -1;
+}
+
+static void receive(int fd, string& stream)
+{
+    char    chunk[65536];
+    ssize_t n;
+    while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+        stream.append(chunk, (size_t)n);
+}
+
+///
+/// Parses 'stream' as "<length> <record>\n" frames and checks every record, returns the number
+/// of the last whole one (-1 for none). Only the end may hold a cut frame, and only if 'cut'.
+///
+static int checkFrames(const string& stream, int first, bool cut)
+{
+    int    last = -1;
+    size_t pos  = 0;
+    while (pos < stream.size())
+    {
+        char*        digitsEnd = NULL;
+        const size_t length    = (size_t)strtoull(stream.c_str() + pos, &digitsEnd, 10);
+        const size_t body      = (size_t)(digitsEnd - stream.c_str()) + 1;
+        if (digitsEnd == stream.c_str() + pos || length == 0 || stream[body - 1] != ' ')
+        {
+            CHECK(!"frame without an octet count");
+            return last;
+        }
+        if (body + length > stream.size())
+        {
+            CHECK(cut);
+            return last;
+        }
+
+        int number = -1;
+        sscanf(stream.c_str() + body, "record %d ", &number);
+        CHECK(number >= first && (last < 0 || number == last + 1));
+        CHECK(number >= 0 && number < RECORDS && stream.compare(body, length, record(number) + "\n") == 0);
+        last = number;
+        pos  = body + length;
+    }
+    return last;
+}
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    string port;
+    const int listenFd = listener(port);
+
+    NetworkSink sink("127.0.0.1", port, NET_TCP, 64 * 1024 * 1024);
+    const int first = acceptSink(listenFd, sink);
+    CHECK(first >= 0);
+
+    // Nothing is read, so the socket soon takes only part of a frame and then nothing. With a
+    // flush per record, like the sink thread on a quiet queue, everything up to that cut frame
+    // is out and the next write() compacts the buffer.
+    for (int i = 0; i < RECORDS; ++i)
+    {
+        LogLine* line = LogLine::create(0, std::string_view(), record(i));
+        sink.write(*line);
+        line->release();
+        sink.flush();
+    }
+    sink.flush();
+    CHECK(sink.isConnected());
+    CHECK(sink.getDroppedCount() == 0);
+
+    // Take what arrived and reset the connection, the send after that fails
+    string before;
+    receive(first, before);
+    struct linger reset = { 1, 0 };
+    setsockopt(first, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    close(first);
+    for (int i = 0; i < 100 && sink.isConnected(); ++i)
+    {
+        sink.flush();
+        sleepMs(1);
+    }
+    CHECK(!sink.isConnected());
+
+    const int lastBefore = checkFrames(before, 0, true);
+    CHECK(lastBefore >= 0 && lastBefore < RECORDS - 1);
+
+    // The new connection starts at a frame boundary and carries everything up to the last record.
+    // Frames still in the kernel's buffers when the connection went are lost with it.
+    const int second = acceptSink(listenFd, sink);
+    CHECK(second >= 0);
+    string after;
+    int    lastAfter = -1;
+    for (int i = 0; i < 2000 && second >= 0 && lastAfter < RECORDS - 1; ++i)
+    {
+        sink.idle();
+        receive(second, after);
+        lastAfter = checkFrames(after, lastBefore + 1, true);
+        sleepMs(1);
+    }
+    CHECK(lastAfter == RECORDS - 1);
+    CHECK(checkFrames(after, lastBefore + 1, false) == RECORDS - 1);
+
+    if (second >= 0)
+        close(second);
+    close(listenFd);
+    return testResult("NetworkSinkTest");
+}
@@ -0,0 +1,139 @@
+// C++ Header File(s)
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "LogSink.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// RecordPool: producer threads create LogLines and one consumer releases them through FreeBatch,
+/// with more owners in a batch than it has chains. The next round's threads adopt the pools of
+/// the exited ones and get exactly the same blocks back, and no block is handed out twice while
+/// in use. Some lines are larger than LOG_POOL_MAX_BLOCK and go to malloc(), run under ASan for
+/// those.
+///
+
+static const int THREADS = 20;
+static const int ROUNDS  = 4;
+static const int LARGE   = 8;
+
+///
+/// The text lengths of one thread's lines: one slab's worth of every block size, so the first
+/// round carves each slab full and leaves no spare block, then a few for malloc()
+///
+static vector<size_t> lengths()
+{
+    vector<size_t> result;
+    for (size_t c = 0; c < LOG_POOL_CLASSES; ++c)
+    {
+        const size_t block = (size_t)1 << (LOG_POOL_MIN_SHIFT + c);
+        for (size_t k = 0; k < LOG_POOL_SLAB_SIZE / block; ++k)
+            result.push_back(block - sizeof(PoolBlock) - sizeof(LogLine) - k % 16);
+    }
+    for (int k = 0; k < LARGE; ++k)
+        result.push_back(LOG_POOL_MAX_BLOCK + 1000 * k);
+    return result;
+}
+
+static const vector<size_t> LENGTHS = lengths();
+
+static string text(size_t i)
+{
+    return string(LENGTHS[i], (char)('a' + i % 26));
+}
+
+static RecordPool* owner(const LogLine* line)
+{
+    return ((const PoolBlock*)line - 1)->owner;
+}
+
+struct Blocks
+{
+    mutex                   lock;
+    set<const LogLine*>     live;       // created and not yet released
+    set<const LogLine*>     pooled;     // the pool blocks of the first round
+    set<RecordPool*>        owners;     // the pools of the first round
+};
+
+/// One round: every thread creates all its lines, then they are released interleaved
+static void round(Blocks& blocks, int r)
+{
+    vector<vector<LogLine*>> created(THREADS);
+    std::atomic<int>         done(0);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&blocks, &created, &done, t, r]
+        {
+            for (size_t i = 0; i < LENGTHS.size(); ++i)
+            {
+                LogLine* line = LogLine::create(0, std::string_view(), text(i));
+                CHECK(line != NULL && line->text() == text(i));
+                created[t].push_back(line);
+
+                lock_guard<mutex> guard(blocks.lock);
+                CHECK(blocks.live.insert(line).second);
+                CHECK((owner(line) == NULL) == (i >= LENGTHS.size() - LARGE));
+                if (owner(line) == NULL)
+                    continue;
+                if (r == 0)
+                {
+                    blocks.owners.insert(owner(line));
+                    CHECK(blocks.pooled.insert(line).second);
+                }
+                else
+                {
+                    CHECK(blocks.owners.count(owner(line)) == 1);
+                    CHECK(blocks.pooled.count(line) == 1);
+                }
+            }
+
+            // A thread that exits early would hand its pool to one that has not started yet
+            done.fetch_add(1);
+            while (done.load() < THREADS)
+                this_thread::yield();
+        });
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    // The producers are gone by now, the next round's threads take the blocks back
+    thread consumer([&blocks, &created]
+    {
+        RecordPool::FreeBatch freed;
+        for (size_t i = 0; i < LENGTHS.size(); ++i)
+        {
+            for (int t = 0; t < THREADS; ++t)
+            {
+                {
+                    lock_guard<mutex> guard(blocks.lock);
+                    CHECK(blocks.live.erase(created[t][i]) == 1);
+                }
+                created[t][i]->release(freed);
+            }
+        }
+    });
+    consumer.join();
+}
+
+int main()
+{
+    Blocks blocks;
+    for (int r = 0; r < ROUNDS; ++r)
+        round(blocks, r);
+
+    CHECK(blocks.live.empty());
+    CHECK(blocks.owners.size() == (size_t)THREADS);
+    CHECK(blocks.pooled.size() == (LENGTHS.size() - LARGE) * THREADS);
+    printf("RecordPoolTest: %zu pool blocks, handed out %d times each\n", blocks.pooled.size(), ROUNDS);
+    return testResult("RecordPoolTest");
+}
@@ -0,0 +1,191 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "Logger.h"
+#include "RingBuffer.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// RingBuffer under several producers, on its own and as the asynchronous queue: nothing is lost
+/// with OVERFLOW_BLOCK, the drop policies account for every record they discard, each producer's
+/// records stay in order, and disableAsyncLog() writes out what is still queued
+///
+
+static const int THREADS = 4;
+static const int RECORDS = 20000;
+
+static uint64_t item(int thread, int i)
+{
+    return ((uint64_t)thread << 32) | (uint64_t)i;
+}
+
+/// Checks that every producer's items come in order, returns the number seen
+static size_t checkOrder(const vector<uint64_t>& items, bool complete)
+{
+    vector<long> next(THREADS, 0);
+    for (size_t k = 0; k < items.size(); ++k)
+    {
+        const int  t = (int)(items[k] >> 32);
+        const long i = (long)(items[k] & 0xffffffffu);
+        CHECK(t >= 0 && t < THREADS);
+        if (t < 0 || t >= THREADS)
+            return 0;
+        CHECK(complete ? i == next[t] : i >= next[t]);
+        next[t] = i + 1;
+    }
+    return items.size();
+}
+
+/// Producers spin on a full queue, the consumer has to see every item once
+static void spinningProducers()
+{
+    RingBuffer<uint64_t> queue(64);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&queue, t]
+        {
+            for (int i = 0; i < RECORDS; ++i)
+                while (!queue.tryPush([t, i](uint64_t& slot) { slot = item(t, i); }))
+                    this_thread::yield();
+        });
+    }
+
+    vector<uint64_t> received;
+    while (received.size() < (size_t)THREADS * RECORDS)
+    {
+        if (!queue.tryPop([&received](uint64_t& slot) { received.push_back(slot); }))
+            this_thread::yield();
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    CHECK(queue.empty() && queue.size() == 0);
+    CHECK(checkOrder(received, false) == (size_t)THREADS * RECORDS);
+
+    // Each producer's items in order and without a gap
+    vector<vector<uint64_t>> perThread(THREADS);
+    for (size_t k = 0; k < received.size(); ++k)
+        perThread[received[k] >> 32].push_back(received[k]);
+    for (int t = 0; t < THREADS; ++t)
+        CHECK(checkOrder(perThread[t], true) == (size_t)RECORDS);
+}
+
+/// Producers pop the oldest item to make room, as OVERFLOW_DROP_OLDEST does
+static void poppingProducers()
+{
+    RingBuffer<uint64_t> queue(16);
+    std::atomic<uint64_t> dropped(0);
+    std::atomic<int>      running(THREADS);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&queue, &dropped, &running, t]
+        {
+            for (int i = 0; i < RECORDS; ++i)
+                while (!queue.tryPush([t, i](uint64_t& slot) { slot = item(t, i); }))
+                    if (queue.tryPop([](uint64_t&) { }))
+                        dropped.fetch_add(1);
+            running.fetch_sub(1);
+        });
+    }
+
+    vector<uint64_t> received;
+    for (;;)
+    {
+        const bool last = (running.load() == 0);
+        while (queue.tryPop([&received](uint64_t& slot) { received.push_back(slot); }))
+        {
+        }
+        if (last && queue.empty())
+            break;
+        this_thread::yield();
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    CHECK(checkOrder(received, false) + dropped.load() == (size_t)THREADS * RECORDS);
+    CHECK(dropped.load() > 0);
+}
+
+/// The records of the log file at 'path' in the order they were written, as items
+static vector<uint64_t> records(const string& path)
+{
+    vector<uint64_t> items;
+    const string text = readFile(path);
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        const size_t end = text.find('\n', pos);
+        const size_t at  = text.find(" thread, ", pos);
+        if (end == string::npos || at == string::npos || at > end)
+        {
+            CHECK(!"malformed record");
+            break;
+        }
+        int t = -1, i = -1;
+        CHECK(sscanf(text.substr(at, end - at).c_str(), " thread, %d, record, %d", &t, &i) == 2);
+        items.push_back(item(t, i));
+        pos = end + 1;
+    }
+    return items;
+}
+
+static void asyncPolicy(const TestDir& dir, OverflowPolicy policy, const char* name)
+{
+    const string file = dir.path(string(name) + ".log");
+    Logger* log = Logger::get(name, file);
+    log->setLogLevel(LOG_LEVEL_INFO);
+
+    // A spinning writer behind a queue of 8: OVERFLOW_BLOCK producers wait on it all the time,
+    // the drop policies discard most records
+    log->setWriterBackoff(BACKOFF_SPIN, 0);
+    log->enableAsyncLog(8, policy);
+
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([log, t]
+        {
+            for (int i = 0; i < RECORDS; ++i)
+                LOG_INFO_TO(log, "thread", t, "record", i);
+        });
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    // Whatever is still queued is written before the writer thread stops
+    log->disableAsyncLog();
+    log->flush();
+
+    const vector<uint64_t> written = records(file);
+    const uint64_t         dropped = log->getDroppedCount();
+    CHECK(checkOrder(written, policy == OVERFLOW_BLOCK) + dropped == (size_t)THREADS * RECORDS);
+    if (policy == OVERFLOW_BLOCK)
+        CHECK(dropped == 0);
+
+    // Logging is synchronous again
+    LOG_INFO_TO(log, "thread", 0, "record", RECORDS);
+    log->flush();
+    CHECK(records(file).size() == written.size() + 1);
+    printf("RingBufferTest: %s wrote %zu, dropped %llu\n", name, written.size(), (unsigned long long)dropped);
+}
+
+int main()
+{
+    spinningProducers();
+    poppingProducers();
+
+    TestDir dir("ringbuffer");
+    asyncPolicy(dir, OVERFLOW_BLOCK, "block");
+    asyncPolicy(dir, OVERFLOW_DROP_NEWEST, "drop-newest");
+    asyncPolicy(dir, OVERFLOW_DROP_OLDEST, "drop-oldest");
+    return testResult("RingBufferTest");
+}
@@ -0,0 +1,122 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <limits>
+#include <string>
+
+// Code Specific Header Files(s)
+#include "StructuredFormat.h"
+#include "TestCheck.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// StructuredFormat: JSON and logfmt encoding of values, the escaping of '"', '\' and control
+/// bytes on both the 16 byte and the byte-wise scan, and the names of NaN and infinity
+///
+
+template <typename T>
+static string json(const T& value)
+{
+    LogFormatter out;
+    StructuredFormat::jsonValue(out, value);
+    return string(out.view());
+}
+
+template <typename T>
+static string logfmt(const T& value)
+{
+    LogFormatter out;
+    StructuredFormat::logfmtValue(out, value);
+    return string(out.view());
+}
+
+static void escaping()
+{
+    CHECK(json("plain") == "\"plain\"");
+    CHECK(json("") == "\"\"");
+    CHECK(json("say \"hi\"") == "\"say \\\"hi\\\"\"");
+    CHECK(json("C:\\dir") == "\"C:\\\\dir\"");
+    CHECK(json("a\nb\rc\td") == "\"a\\nb\\rc\\td\"");
+    CHECK(json(string("nul\0bell\a", 9)) == "\"nul\\u0000bell\\u0007\"");
+    CHECK(json("\x1f") == "\"\\u001f\"");
+
+    // UTF-8 and DEL need no escaping
+    CHECK(json("gr\xc3\xbc\xc3\x9f \x7f") == "\"gr\xc3\xbc\xc3\x9f \x7f\"");
+
+    // Every position of a 16 byte block and the byte-wise tail after it
+    const string clean(40, 'x');
+    const char   specials[] = { '"', '\\', '\n', '\x01' };
+    const char*  escaped[]  = { "\\\"", "\\\\", "\\n", "\\u0001" };
+    for (size_t s = 0; s < sizeof(specials); ++s)
+    {
+        for (size_t pos = 0; pos < clean.size(); ++pos)
+        {
+            string text = clean;
+            text[pos] = specials[s];
+            const string expected = "\"" + clean.substr(0, pos) + escaped[s] + clean.substr(pos + 1) + "\"";
+            CHECK(json(text) == expected);
+        }
+    }
+
+    // Back to back within one block, and one in each of several blocks
+    string quotes;
+    for (int i = 0; i < 20; ++i)
+        quotes += "\\\"";
+    CHECK(json(string(20, '"')) == "\"" + quotes + "\"");
+    CHECK(json(string(15, 'a') + "\\" + string(15, 'b') + "\\" + string(15, 'c')) ==
+          "\"" + string(15, 'a') + "\\\\" + string(15, 'b') + "\\\\" + string(15, 'c') + "\"");
+}
+
+static void logfmtQuoting()
+{
+    CHECK(logfmt("plain") == "plain");
+    CHECK(logfmt("") == "\"\"");
+    CHECK(logfmt("two words") == "\"two words\"");
+    CHECK(logfmt("a=b") == "\"a=b\"");
+    CHECK(logfmt("say \"hi\"") == "\"say \\\"hi\\\"\"");
+    CHECK(logfmt("C:\\dir") == "\"C:\\\\dir\"");
+    CHECK(logfmt("line\n") == "\"line\\n\"");
+
+    // Found by the 16 byte scan as well
+    CHECK(logfmt(string(20, 'x') + " " + string(20, 'y')) == "\"" + string(20, 'x') + " " + string(20, 'y') + "\"");
+    CHECK(logfmt(string(20, 'x') + "=" + string(20, 'y')) == "\"" + string(20, 'x') + "=" + string(20, 'y') + "\"");
+    CHECK(logfmt(string(40, 'x')) == string(40, 'x'));
+
+    // JSON leaves space and '=' alone
+    CHECK(json("a = b") == "\"a = b\"");
+}
+
+static void values()
+{
+    CHECK(json(true) == "true" && logfmt(false) == "false");
+    CHECK(json(-42) == "-42" && logfmt(18446744073709551615ull) == "18446744073709551615");
+    CHECK(json('c') == "\"c\"" && logfmt('c') == "c");
+    CHECK(json('"') == "\"\\\"\"" && logfmt(' ') == "\" \"");
+    CHECK(json(string("std::string")) == "\"std::string\"");
+    CHECK(json((const char*)NULL) == "\"(null)\"");
+
+    // char arrays stop at their first NUL
+    const char buffer[16] = "short";
+    CHECK(json(buffer) == "\"short\"");
+
+    LogFormatter number;
+    number.write(1.5);
+    CHECK(json(1.5) == string(number.view()) && logfmt(1.5) == string(number.view()));
+
+    // JSON has no NaN or infinity, they become strings, logfmt writes them bare
+    const double nan = numeric_limits<double>::quiet_NaN();
+    const double inf = numeric_limits<double>::infinity();
+    CHECK(json(nan) == "\"nan\"" && logfmt(nan) == "nan");
+    CHECK(json(inf) == "\"inf\"" && logfmt(inf) == "inf");
+    CHECK(json(-inf) == "\"-inf\"" && logfmt(-inf) == "-inf");
+    CHECK(json((float)-inf) == "\"-inf\"" && logfmt(numeric_limits<float>::quiet_NaN()) == "nan");
+}
+
+int main()
+{
+    escaping();
+    logfmtQuoting();
+    values();
+    return testResult("StructuredFormatTest");
+}
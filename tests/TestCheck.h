@@ -0,0 +1,87 @@
+#ifndef _TEST_CHECK_H_
+#define _TEST_CHECK_H_
+
+// C++ Header File(s)
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// POSIX Socket Header File(s)
+#include <ftw.h>
+#include <unistd.h>
+
+///
+/// Checks of the behaviour tests. A failed CHECK prints where and what and the test goes on,
+/// testResult() turns the failures into the exit status ctest looks at.
+///
+inline int g_TestFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("%s:%d: CHECK(%s) failed!!\n", __FILE__, __LINE__, #cond); \
+            ++g_TestFailures; \
+        } \
+    } while (0)
+
+inline int testResult(const char* name)
+{
+    printf("%s: %s\n", name, g_TestFailures ? "FAILED" : "passed");
+    return g_TestFailures ? 1 : 0;
+}
+
+inline std::string readFile(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::in|std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+inline void writeFile(const std::string& path, const std::string& data)
+{
+    std::ofstream out(path.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+///
+/// Scratch directory below the working directory (ctest runs the tests in the build tree,
+/// which O_DIRECT needs to be a real file system), removed again with its content
+///
+class TestDir
+{
+  public:
+     explicit TestDir(const char* name)
+     {
+         std::string pattern = std::string(name) + ".XXXXXX";
+         if (mkdtemp(&pattern[0]) == NULL)
+         {
+             printf("TestDir::TestDir() -- Unable to create %s!!\n", pattern.c_str());
+             exit(1);
+         }
+         m_Path = pattern;
+     }
+
+     ~TestDir()
+     {
+         nftw(m_Path.c_str(), &TestDir::remove, 16, FTW_DEPTH|FTW_PHYS);
+     }
+
+     std::string path(const std::string& file) const { return m_Path + "/" + file; }
+
+  private:
+     static int remove(const char* path, const struct stat*, int, struct FTW*)
+     {
+         ::remove(path);
+         return 0;
+     }
+
+     TestDir(const TestDir& obj);
+     void operator=(const TestDir& obj);
+
+  private:
+     std::string m_Path;
+};
+
+#endif // End of _TEST_CHECK_H_
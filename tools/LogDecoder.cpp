@@ -0,0 +1,139 @@
+// C++ Header File(s)
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Code Specific Header Files(s)
+#include "BinaryLog.h"
+#include "Timestamp.h"
+
+using namespace std;
+using namespace CPlusPlusLogging;
+
+///
+/// LogDecoder turns a binary log file written in ENCODE_BINARY mode back into the text format
+/// the logger writes in text mode:
+///
+///     LogDecoder <logfile.bin> [--level N] [--precision 0|3|6]
+///
+/// Lines go to stdout. --level skips records whose level is above N (LOG_LEVEL values),
+/// --precision appends milliseconds (3) or microseconds (6) to the timestamps.
+///
+struct SiteInfo
+{
+    int32_t level;
+    int32_t line;
+    string  prefix;
+    string  file;
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <logfile.bin> [--level N] [--precision 0|3|6]" << endl;
+        return 1;
+    }
+
+    int32_t        maxLevel = INT32_MAX;
+    TimestampCache timestamps;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--level") == 0)
+            maxLevel = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--precision") == 0)
+            timestamps.setPrecision((TimestampPrecision)atoi(argv[i + 1]));
+    }
+
+    ifstream in(argv[1], ios::in|ios::binary);
+    if (!in.is_open())
+    {
+        cerr << "LogDecoder -- Unable to open " << argv[1] << endl;
+        return 1;
+    }
+    vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    unordered_map<uint64_t, SiteInfo> sites;
+    const char* pos = data.data();
+    const char* end = pos + data.size();
+    size_t      unknown = 0;
+
+    while (pos < end)
+    {
+        // A new section starts with every process run, its call site keys start over
+        if ((size_t)(end - pos) >= BINARY_LOG_MAGIC_SIZE && memcmp(pos, BINARY_LOG_MAGIC, BINARY_LOG_MAGIC_SIZE) == 0)
+        {
+            sites.clear();
+            pos += BINARY_LOG_MAGIC_SIZE;
+            continue;
+        }
+
+        uint32_t length;
+        if (!BinaryDecoder::getInt(pos, end, length) || length == 0 || (size_t)(end - pos) < length)
+        {
+            cerr << "LogDecoder -- Truncated record at offset " << (pos - data.data()) << endl;
+            return 2;
+        }
+
+        const char* record    = pos + 1;
+        const char* recordEnd = pos + length;
+        const char  kind      = *pos;
+        pos = recordEnd;
+
+        if (kind == BINARY_SITE)
+        {
+            uint64_t         key;
+            SiteInfo         site;
+            std::string_view prefix, file;
+            if (!BinaryDecoder::getInt(record, recordEnd, key) ||
+                !BinaryDecoder::getInt(record, recordEnd, site.level) ||
+                !BinaryDecoder::getInt(record, recordEnd, site.line) ||
+                ++record > recordEnd || !BinaryDecoder::getString(record, recordEnd, prefix) ||
+                ++record > recordEnd || !BinaryDecoder::getString(record, recordEnd, file))
+            {
+                cerr << "LogDecoder -- Malformed call site record" << endl;
+                continue;
+            }
+            site.prefix.assign(prefix.data(), prefix.size());
+            site.file.assign(file.data(), file.size());
+            sites[key] = site;
+        }
+        else if (kind == BINARY_ENTRY)
+        {
+            uint64_t key, timestamp;
+            if (!BinaryDecoder::getInt(record, recordEnd, key) ||
+                !BinaryDecoder::getInt(record, recordEnd, timestamp))
+                continue;
+
+            unordered_map<uint64_t, SiteInfo>::const_iterator site = sites.find(key);
+            if (site == sites.end())
+            {
+                ++unknown;
+                continue;
+            }
+            if (site->second.level > maxLevel)
+                continue;
+
+            char   stamp[TIMESTAMP_MAX_LENGTH];
+            size_t stampLength = timestamps.render(timestamp, stamp);
+
+            LogFormatter fmt(std::string_view(stamp, stampLength));
+            fmt.append("  ", 2);
+            fmt.append(site->second.prefix);
+            if (!BinaryDecoder::renderArgs(record, recordEnd, fmt))
+                fmt.append(" <malformed arguments>");
+
+            cout.write(fmt.view().data(), fmt.view().size()) << '\n';
+        }
+    }
+
+    if (unknown != 0)
+        cerr << "LogDecoder -- " << unknown << " record(s) without call site description" << endl;
+
+    return 0;
+}
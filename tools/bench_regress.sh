@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Builds logger_bench, runs it and keeps the result as _bench/<commit>.json. The real time of
+# every benchmark is then compared with the previous result; a benchmark that got slower by
+# more than THRESHOLD percent (default 10) is flagged and makes the script exit with 1.
+#
+# usage: tools/bench_regress.sh <dir with Utils.h and ConfigFile.h> [benchmark filter]
+#
+set -e
+
+UTILS_DIR="$1"
+FILTER="${2:-.}"
+THRESHOLD="${THRESHOLD:-10}"
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="$ROOT/_bench/build"
+
+if [ -z "$UTILS_DIR" ]; then
+    echo "usage: $0 <utils dir> [benchmark filter]" >&2
+    exit 2
+fi
+
+cmake -S "$ROOT" -B "$BUILD" -DCMAKE_BUILD_TYPE=Release -DLOGGER_UTILS_DIR="$UTILS_DIR" >/dev/null
+cmake --build "$BUILD" --target logger_bench -j"$(nproc)" >/dev/null
+
+COMMIT="$(git -C "$ROOT" rev-parse --short HEAD)"
+if [ -n "$(git -C "$ROOT" status --porcelain --untracked-files=no)" ]; then
+    COMMIT="$COMMIT-dirty"
+fi
+PREVIOUS="$(ls -t "$ROOT"/_bench/*.json 2>/dev/null | grep -v "/$COMMIT.json$" | head -n 1 || true)"
+RESULT="$ROOT/_bench/$COMMIT.json"
+
+"$BUILD/logger_bench" --benchmark_filter="$FILTER" --benchmark_out="$RESULT" --benchmark_out_format=json
+
+if [ -z "$PREVIOUS" ]; then
+    echo "No previous result, $RESULT is the baseline"
+    exit 0
+fi
+
+python3 - "$PREVIOUS" "$RESULT" "$THRESHOLD" <<'PY'
+import json, sys
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b["real_time"] for b in json.load(f)["benchmarks"] if b.get("run_type", "iteration") == "iteration"}
+
+before, after, threshold = load(sys.argv[1]), load(sys.argv[2]), float(sys.argv[3])
+print("\n%-48s %12s %12s %8s" % ("benchmark (" + sys.argv[1].rsplit("/", 1)[-1] + " -> now)", "before", "after", "change"))
+slower = 0
+for name, now in after.items():
+    if name not in before or before[name] == 0:
+        continue
+    change = (now - before[name]) * 100.0 / before[name]
+    flag = ""
+    if change > threshold:
+        flag, slower = "  SLOWER", slower + 1
+    print("%-48s %12.1f %12.1f %+7.1f%%%s" % (name, before[name], now, change, flag))
+sys.exit(1 if slower else 0)
+PY